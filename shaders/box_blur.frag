@@ -0,0 +1,26 @@
+/* vim: set filetype=glsl : */
+
+in vec2 vs_uv;
+
+uniform sampler2D frame;
+uniform int radius;
+uniform vec2 direction;
+
+out vec4 fs_color;
+
+// One pass of a separable box blur, run once along x and once along y.
+// The box has the same variance as the poisson disc of sample_texture.
+void main() {
+    vec2 uv_step = direction / vec2(textureSize(frame, 0));
+    int r = int(round(BOX_BLUR_SCALE * float(radius)));
+    vec3 color = vec3(0.0);
+    float n = 0.0;
+    for (int i = -r; i <= r; ++i) {
+        vec2 uv = vs_uv + float(i) * uv_step;
+        if (uv.x >= 0.0 && uv.x <= 1.0 && uv.y >= 0.0 && uv.y <= 1.0) {
+            color += texture(frame, uv).rgb;
+            n += 1.0;
+        }
+    }
+    fs_color = vec4(color / n, 1.0);
+}
@@ -3,17 +3,20 @@
 in vec2 vs_uv;
 
 uniform sampler2D frame;
-uniform vec3 white_balance;
-uniform float exposure;
-uniform float temperature;
-uniform float contrast;
-uniform float brightness;
-uniform float saturation;
-uniform float gamma;
+
+layout(std140) uniform Params {
+    vec3 white_balance;
+    float exposure;
+    float temperature;
+    float contrast;
+    float brightness;
+    float saturation;
+    float gamma;
+};
 
 out vec4 fs_color;
 
-vec3 apply_color_correction(vec3 color) {
+vec3 apply(vec3 color) {
     // Exposure
     if (exposure >= 0.0) {
         color = vec3(1.0) - exp(-color * exposure);
@@ -48,6 +51,5 @@ vec3 apply_color_correction(vec3 color) {
 
 void main() {
     vec3 color = texture(frame, vs_uv).rgb;
-    color = apply_color_correction(color);
-    fs_color = vec4(color, 1.0);
+    fs_color = vec4(apply(color), 1.0);
 }
@@ -3,19 +3,28 @@
 in vec2 vs_uv;
 
 uniform sampler2D frame;
-uniform vec3 color;
-uniform float threshold;
-uniform int n_samples;
-uniform int radius;
+uniform sampler2D edges;
+
+layout(std140) uniform Params {
+    vec3 color;
+    float threshold;
+    int n_samples;
+    int radius;
+    bool fast_outline;
+    bool temporal_noise;
+};
 
 out vec4 fs_color;
 
 float sample_outline(sampler2D tex, vec2 uv, float threshold, float n_samples, float radius) {
-    vec2 uv_step = 1.0 / vec2(textureSize(tex, 0));
+    ivec2 size = textureSize(tex, 0);
+    vec2 uv_step = 1.0 / vec2(size);
+    float noise = get_blue_noise(ivec2(uv * vec2(size)), temporal_noise ? frame_idx : 0);
+    mat2 rotation = get_poisson_disc_rotation(noise);
     vec3 prev_color = rgb2hsv(texture(tex, uv).rgb);
     float max_dist = 0.0;
     for (int i = 0; i < int(n_samples); ++i) {
-        vec2 disc = sample_poisson_disc(uv, i);
+        vec2 disc = sample_poisson_disc(noise, rotation, i);
         vec2 uv_ = uv + radius * uv_step * disc;
         if (uv_.x >= 0.0 && uv_.x <= 1.0 && uv_.y >= 0.0 && uv_.y <= 1.0) {
             vec3 curr_color = rgb2hsv(texture(tex, uv_).rgb);
@@ -28,13 +37,18 @@ float sample_outline(sampler2D tex, vec2 uv, float threshold, float n_samples, f
 }
 
 void main(void) {
-    float outline = sample_outline(
-        frame,
-        vs_uv,
-        threshold,
-        float(n_samples),
-        float(radius)
-    );
+    // with fast_outline the edges are the dilated gradient magnitude
+    // from outline_edges.frag and max_filter.frag passes
+    float outline = float(texture(edges, vs_uv).r > threshold);
+    if (!fast_outline) {
+        outline = sample_outline(
+            frame,
+            vs_uv,
+            threshold,
+            float(n_samples),
+            float(radius)
+        );
+    }
 
     vec3 frame_color = texture(frame, vs_uv).rgb;
     vec3 final_color = mix(frame_color, color, outline);
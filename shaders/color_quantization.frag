@@ -3,9 +3,14 @@
 in vec2 vs_uv;
 
 uniform sampler2D frame;
-uniform int n_levels;
-uniform int n_samples;
-uniform int radius;
+
+layout(std140) uniform Params {
+    int n_levels;
+    int n_samples;
+    int radius;
+    bool fast_blur;
+    bool temporal_noise;
+};
 
 out vec4 fs_color;
 
@@ -23,13 +28,21 @@ vec3 quantize_color(vec3 color, float n_levels) {
     return hsv2rgb(hsv);
 }
 
+vec3 apply(vec3 color) {
+    return quantize_color(color, float(n_levels));
+}
+
 void main() {
-    vec3 color = sample_texture(
-            frame,
-            vs_uv,
-            float(n_samples),
-            float(radius)
-        );
-    color = quantize_color(color, float(n_levels));
-    fs_color = vec4(color, 1.0);
+    // with fast_blur the frame is already blurred by box_blur.frag passes
+    vec3 color = texture(frame, vs_uv).rgb;
+    if (!fast_blur) {
+        color = sample_texture(
+                frame,
+                vs_uv,
+                float(n_samples),
+                float(radius),
+                temporal_noise ? frame_idx : 0
+            );
+    }
+    fs_color = vec4(apply(color), 1.0);
 }
@@ -0,0 +1,25 @@
+/* vim: set filetype=glsl : */
+
+in vec2 vs_uv;
+
+uniform sampler2D frame;
+uniform int pixel_size;
+
+out vec4 fs_color;
+
+// Box filter: each output texel is the average of a pixel_size block of
+// the input, blocks on the right and bottom edges might be partial
+void main(void) {
+    ivec2 size = textureSize(frame, 0);
+    ivec2 p0 = ivec2(gl_FragCoord.xy) * pixel_size;
+    ivec2 p1 = min(p0 + pixel_size, size);
+
+    vec3 color = vec3(0.0);
+    for (int y = p0.y; y < p1.y; ++y) {
+        for (int x = p0.x; x < p1.x; ++x) {
+            color += texelFetch(frame, ivec2(x, y), 0).rgb;
+        }
+    }
+    vec2 n = vec2(p1 - p0);
+    fs_color = vec4(color / (n.x * n.y), 1.0);
+}
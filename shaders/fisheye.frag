@@ -3,11 +3,14 @@
 in vec2 vs_uv;
 
 uniform sampler2D frame;
-uniform float strength;
+
+layout(std140) uniform Params {
+    float strength;
+};
 
 out vec4 fs_color;
 
-vec2 apply_fisheye(vec2 p) {
+vec2 map(vec2 p) {
     vec2 center = vec2(0.5, 0.5);
     vec2 d = p - center;
     float r = sqrt(dot(d, d));
@@ -26,7 +29,7 @@ vec2 apply_fisheye(vec2 p) {
 }
 
 void main(void) {
-    vec2 uv = apply_fisheye(vs_uv);
+    vec2 uv = map(vs_uv);
     vec3 color = texture(frame, uv).rgb;
     fs_color = vec4(color, 1.0);
 }
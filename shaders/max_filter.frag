@@ -0,0 +1,23 @@
+/* vim: set filetype=glsl : */
+
+in vec2 vs_uv;
+
+uniform sampler2D frame;
+uniform int radius;
+uniform vec2 direction;
+
+out vec4 fs_color;
+
+// One pass of a separable max filter (dilation), run once along x and
+// once along y
+void main() {
+    ivec2 size = textureSize(frame, 0);
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    ivec2 dir = ivec2(direction);
+    vec3 color = vec3(0.0);
+    for (int i = -radius; i <= radius; ++i) {
+        ivec2 p_ = clamp(p + i * dir, ivec2(0), size - 1);
+        color = max(color, texelFetch(frame, p_, 0).rgb);
+    }
+    fs_color = vec4(color, 1.0);
+}
@@ -6,13 +6,15 @@
 in vec2 vs_uv;
 
 uniform sampler2D frame;
-uniform float vert_jerk;
-uniform float vert_movement;
-uniform float bottom_static;
-uniform float scanlines;
-uniform float rgb_offset;
-uniform float horz_fuzz;
-uniform float time;
+
+layout(std140) uniform Params {
+    float vert_jerk;
+    float vert_movement;
+    float bottom_static;
+    float scanlines;
+    float rgb_offset;
+    float horz_fuzz;
+};
 
 out vec4 fs_color;
 
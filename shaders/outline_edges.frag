@@ -0,0 +1,29 @@
+/* vim: set filetype=glsl : */
+
+in vec2 vs_uv;
+
+uniform sampler2D frame;
+
+out vec4 fs_color;
+
+// hsv value, same as rgb2hsv(c).z
+float get_value(ivec2 p) {
+    ivec2 size = textureSize(frame, 0);
+    vec3 c = texelFetch(frame, clamp(p, ivec2(0), size - 1), 0).rgb;
+    return max(c.r, max(c.g, c.b));
+}
+
+// Scharr gradient magnitude of the value, normalized so that a step of
+// height d gives d
+void main() {
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    float v[9];
+    for (int i = 0; i < 9; ++i) {
+        v[i] = get_value(p + ivec2(i % 3 - 1, i / 3 - 1));
+    }
+
+    float gx = 3.0 * (v[2] - v[0]) + 10.0 * (v[5] - v[3]) + 3.0 * (v[8] - v[6]);
+    float gy = 3.0 * (v[6] - v[0]) + 10.0 * (v[7] - v[1]) + 3.0 * (v[8] - v[2]);
+    float magnitude = length(vec2(gx, gy)) / 16.0;
+    fs_color = vec4(vec3(magnitude), 1.0);
+}
@@ -3,11 +3,14 @@
 in vec2 vs_uv;
 
 uniform sampler2D frame;
-uniform int pixel_size;
+
+layout(std140) uniform Params {
+    int pixel_size;
+};
 
 out vec4 fs_color;
 
-vec2 pixelize(vec2 uv) {
+vec2 map(vec2 uv) {
     if (pixel_size <= 1) {
         return uv;
     }
@@ -18,9 +21,8 @@ vec2 pixelize(vec2 uv) {
     return uv;
 }
 
-
 void main(void) {
-    vec2 uv = pixelize(vs_uv);
+    vec2 uv = map(vs_uv);
     vec3 color = texture(frame, uv).rgb;
     fs_color = vec4(color, 1.0);
 }
@@ -0,0 +1,33 @@
+/* vim: set filetype=glsl : */
+
+in vec2 vs_uv;
+
+uniform sampler2D frame;
+uniform sampler2D remap;
+
+out vec4 fs_color;
+
+ivec2 wrap(ivec2 p, ivec2 size) {
+    return p - size * ivec2(floor(vec2(p) / vec2(size)));
+}
+
+// bilinear with GL_REPEAT wrapping, same as cv::remap with BORDER_WRAP
+vec3 sample_bilinear(sampler2D tex, vec2 uv) {
+    ivec2 size = textureSize(tex, 0);
+    vec2 p = uv * vec2(size) - 0.5;
+    ivec2 p0 = ivec2(floor(p));
+    vec2 t = p - vec2(p0);
+
+    vec3 c00 = texelFetch(tex, wrap(p0, size), 0).rgb;
+    vec3 c10 = texelFetch(tex, wrap(p0 + ivec2(1, 0), size), 0).rgb;
+    vec3 c01 = texelFetch(tex, wrap(p0 + ivec2(0, 1), size), 0).rgb;
+    vec3 c11 = texelFetch(tex, wrap(p0 + ivec2(1, 1), size), 0).rgb;
+    return mix(mix(c00, c10, t.x), mix(c01, c11, t.x), t.y);
+}
+
+// the remap texture holds the input uv of each output pixel
+void main(void) {
+    vec2 uv = texelFetch(remap, ivec2(gl_FragCoord.xy), 0).xy;
+    vec3 color = sample_bilinear(frame, uv);
+    fs_color = vec4(color, 1.0);
+}
@@ -0,0 +1,64 @@
+/* vim: set filetype=glsl : */
+
+in vec2 vs_uv;
+
+uniform sampler2D frame;
+uniform ivec2 out_size;
+
+layout(std140) uniform Params {
+    bool nearest;
+};
+
+out vec4 fs_color;
+
+vec3 fetch(ivec2 p, ivec2 size) {
+    return texelFetch(frame, clamp(p, ivec2(0), size - 1), 0).rgb;
+}
+
+// average of the input pixels covered by the output pixel, weighted by the
+// covered area, same as cv::INTER_AREA
+vec3 sample_area(ivec2 size, vec2 ratio) {
+    vec2 p0 = (gl_FragCoord.xy - 0.5) * ratio;
+    vec2 p1 = p0 + ratio;
+    ivec2 i0 = ivec2(floor(p0));
+    ivec2 i1 = min(ivec2(ceil(p1)), size);
+
+    vec3 color = vec3(0.0);
+    for (int y = i0.y; y < i1.y; ++y) {
+        float wy = min(p1.y, float(y + 1)) - max(p0.y, float(y));
+        for (int x = i0.x; x < i1.x; ++x) {
+            float wx = min(p1.x, float(x + 1)) - max(p0.x, float(x));
+            color += fetch(ivec2(x, y), size) * wx * wy;
+        }
+    }
+    return color / (ratio.x * ratio.y);
+}
+
+// bilinear with clamped edges, same as cv::INTER_LINEAR
+vec3 sample_bilinear(ivec2 size, vec2 ratio) {
+    vec2 p = gl_FragCoord.xy * ratio - 0.5;
+    ivec2 p0 = ivec2(floor(p));
+    vec2 t = p - vec2(p0);
+
+    vec3 c00 = fetch(p0, size);
+    vec3 c10 = fetch(p0 + ivec2(1, 0), size);
+    vec3 c01 = fetch(p0 + ivec2(0, 1), size);
+    vec3 c11 = fetch(p0 + ivec2(1, 1), size);
+    return mix(mix(c00, c10, t.x), mix(c01, c11, t.x), t.y);
+}
+
+void main(void) {
+    ivec2 size = textureSize(frame, 0);
+    vec2 ratio = vec2(size) / vec2(out_size);
+
+    vec3 color;
+    if (nearest) {
+        // same as cv::INTER_NEAREST
+        color = fetch(ivec2(floor((gl_FragCoord.xy - 0.5) * ratio)), size);
+    } else if (ratio.x >= 1.0 && ratio.y >= 1.0) {
+        color = sample_area(size, ratio);
+    } else {
+        color = sample_bilinear(size, ratio);
+    }
+    fs_color = vec4(color, 1.0);
+}
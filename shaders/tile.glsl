@@ -0,0 +1,44 @@
+/* vim: set filetype=glsl : */
+
+// Compute shaders of the nodes with wide gathers: a group of TILE_SIZE x
+// TILE_SIZE invocations loads its tile of the frame with a HALO texels wide
+// border into shared memory once, then the taps are served from there. HALO
+// is defined by the pass, see ComputePass.
+
+#define TILE_SIZE 16
+#define TILE_SPAN (TILE_SIZE + 2 * HALO)
+
+layout(local_size_x = TILE_SIZE, local_size_y = TILE_SIZE) in;
+
+uniform sampler2D frame;
+layout(rgba8) uniform writeonly image2D out_frame;
+
+// the frames are 8 bit, packed they take a quarter of the space
+shared uint tile[TILE_SPAN * TILE_SPAN];
+
+// frame pixel of the first tile texel
+ivec2 get_tile_origin() {
+    return ivec2(gl_WorkGroupID.xy) * TILE_SIZE - HALO;
+}
+
+// all the invocations of the group must call it, the ones outside of the
+// frame too
+void load_tile() {
+    ivec2 size = textureSize(frame, 0);
+    ivec2 origin = get_tile_origin();
+    int n = TILE_SPAN * TILE_SPAN;
+    for (int i = int(gl_LocalInvocationIndex); i < n; i += TILE_SIZE * TILE_SIZE) {
+        ivec2 p = origin + ivec2(i % TILE_SPAN, i / TILE_SPAN);
+        p = clamp(p, ivec2(0), size - 1);
+        tile[i] = packUnorm4x8(texelFetch(frame, p, 0));
+    }
+    barrier();
+}
+
+// the nearest texel, as texture() with the point filter of the frames, uv
+// must be within HALO texels of the tile
+vec3 sample_tile(vec2 uv) {
+    ivec2 size = textureSize(frame, 0);
+    ivec2 p = min(ivec2(uv * vec2(size)), size - 1) - get_tile_origin();
+    return unpackUnorm4x8(tile[p.y * TILE_SPAN + p.x]).rgb;
+}
@@ -1,6 +1,7 @@
 #include "app.hpp"
 
 #include "GLFW/glfw3.h"
+#include "cpu.hpp"
 #include "graph.hpp"
 #include "imgui/imgui.h"
 #include "imgui/imgui_impl_glfw.h"
@@ -8,8 +9,67 @@
 #include "imgui/imgui_node_editor.h"
 #include "raylib/raylib.h"
 #include "raylib/rlgl.h"
+#include "trace.hpp"
+#include <exception>
+#include <optional>
+
+// the editor keeps the node positions in its own settings file
+static const char *GRAPH_FILE_NAME = "freska_graph.json";
+static const char *TRACE_FILE_NAME = "freska_trace.json";
+
+// false if the file couldn't be loaded, the graph is empty then
+static bool load_graph(Graph &graph) {
+    try {
+        graph.load(GRAPH_FILE_NAME);
+        return true;
+    } catch (const std::exception &e) {
+        // the graph is unchanged
+        TraceLog(LOG_WARNING, "APP: %s", e.what());
+        return false;
+    }
+}
+
+static bool save_graph(Graph &graph) {
+    try {
+        graph.save(GRAPH_FILE_NAME);
+        return true;
+    } catch (const std::exception &e) {
+        TraceLog(LOG_WARNING, "APP: %s", e.what());
+        return false;
+    }
+}
+
+// p50 and p99 of each stage under the fps
+static void draw_latency(LatencyStats &latency) {
+    const char *names[] = {"capture", "graph", "output", "total"};
+    LatencyHistogram *histograms[] = {
+        &latency.capture, &latency.graph, &latency.output, &latency.total
+    };
+    for (int i = 0; i < 4; ++i) {
+        auto text = TextFormat(
+            "%-8s p50 %6.1f ms, p99 %6.1f ms",
+            names[i],
+            histograms[i]->get_percentile_ms(0.5),
+            histograms[i]->get_percentile_ms(0.99)
+        );
+        DrawText(text, 0, 20 * (i + 1), 20, LIME);
+    }
+}
+
+static void save_trace_file() {
+    try {
+        save_trace(TRACE_FILE_NAME);
+        TraceLog(LOG_INFO, "APP: Saved %s", TRACE_FILE_NAME);
+    } catch (const std::exception &e) {
+        TraceLog(LOG_WARNING, "APP: %s", e.what());
+    }
+}
 
-App::App() {
+App::App()
+    : shader_watcher("shaders")
+    , is_latency_shown(true)
+    , is_autosaved(true) {
+    set_trace_thread_name("main");
     InitWindow(1600, 1100, "Freska");
     SetTargetFPS(60);
     rlDisableBackfaceCulling();
@@ -28,19 +88,30 @@ App::App() {
     this->context = ed::CreateEditor(&config);
 
     this->graph = Graph();
+    if (FileExists(GRAPH_FILE_NAME)) this->is_autosaved = load_graph(this->graph);
 }
 
 App::~App() {
+    if (this->is_autosaved) save_graph(this->graph);
+    // the writers flush their frames in flight and the nodes unload their
+    // textures while the context is still there
+    this->graph = Graph();
+    this->thumbnails = Thumbnails();
     ed::DestroyEditor(this->context);
 
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 
+    set_gl_closed();
     CloseWindow();
 }
 
 void App::update_and_draw() {
+    // the editor until the graph update, the graph traces its own
+    std::optional<TraceScope> ui_scope;
+    ui_scope.emplace("ui", "draw");
+
     BeginDrawing();
     ClearBackground(BLANK);
 
@@ -48,9 +119,19 @@ void App::update_and_draw() {
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
 
+    // the editor fills the rest of the window
+    ImVec2 screen_min = ImGui::GetCursorScreenPos();
+    ImVec2 screen_size = ImGui::GetContentRegionAvail();
+
     ed::SetCurrentEditor(this->context);
     ed::Begin("Freska", ImVec2(0.0, 0.0f));
 
+    // the visible part of the canvas, the previews outside of it aren't drawn
+    ImVec2 view_min = ed::ScreenToCanvas(screen_min);
+    ImVec2 view_max = ed::ScreenToCanvas(
+        {screen_min.x + screen_size.x, screen_min.y + screen_size.y}
+    );
+
     auto mouse_position = ImGui::GetMousePos();
 
     // ---------------------------------------------------------------
@@ -76,6 +157,70 @@ void App::update_and_draw() {
             ed::SetNodePosition(node_id, mouse_position);
         }
 
+        ImGui::Separator();
+        bool is_cpu = graph.backend == Backend::CPU;
+        if (ImGui::MenuItem("CPU Backend", nullptr, &is_cpu)) {
+            graph.backend = is_cpu ? Backend::CPU : Backend::GPU;
+        }
+        if (ImGui::MenuItem("Node Timings", nullptr, &graph.profiler.is_enabled)) {
+            graph.profiler.clear();
+        }
+        ImGui::MenuItem("Latency", nullptr, &this->is_latency_shown);
+        if (ImGui::MenuItem("Reset Latency")) graph.latency.clear();
+
+        if (ImGui::BeginMenu("Proxy")) {
+            const char *names[] = {"Full", "1/2", "1/4"};
+            for (int i = 0; i < 3; ++i) {
+                int proxy_scale = 1 << i;
+                bool is_selected = graph.proxy_scale == proxy_scale;
+                if (ImGui::MenuItem(names[i], nullptr, is_selected)) {
+                    graph.proxy_scale = proxy_scale;
+                }
+            }
+            ImGui::EndMenu();
+        }
+
+        if (ImGui::BeginMenu("Preview Refresh")) {
+            const char *names[] = {"60 Hz", "15 Hz", "5 Hz"};
+            float rates[] = {60.0, 15.0, 5.0};
+            for (int i = 0; i < 3; ++i) {
+                bool is_selected = this->thumbnails.refresh_rate == rates[i];
+                if (ImGui::MenuItem(names[i], nullptr, is_selected)) {
+                    this->thumbnails.refresh_rate = rates[i];
+                }
+            }
+            ImGui::EndMenu();
+        }
+
+        if (ImGui::BeginMenu("CPU Precision")) {
+            const char *names[] = {"F32", "F16", "U16", "U8"};
+            for (int i = 0; i < 4; ++i) {
+                auto precision = (CpuPrecision)i;
+                bool is_selected = graph.cpu_backend->precision == precision;
+                if (ImGui::MenuItem(names[i], nullptr, is_selected)) {
+                    graph.cpu_backend->precision = precision;
+                    graph.is_dirty = true;
+                }
+            }
+            ImGui::EndMenu();
+        }
+
+        ImGui::Separator();
+        if (ImGui::MenuItem("Save Graph")) this->is_autosaved = save_graph(graph);
+        if (ImGui::MenuItem("Load Graph") && FileExists(GRAPH_FILE_NAME)) {
+            this->is_autosaved = load_graph(graph);
+        }
+
+        ImGui::Separator();
+        if (ImGui::MenuItem(is_tracing() ? "Stop Trace" : "Start Trace")) {
+            if (is_tracing()) {
+                stop_trace();
+            } else {
+                start_trace();
+            }
+        }
+        if (ImGui::MenuItem("Save Trace")) save_trace_file();
+
         ImGui::EndPopup();
     }
     ed::Resume();
@@ -91,6 +236,10 @@ void App::update_and_draw() {
 
     ed::Suspend();
     if (ImGui::BeginPopup("Node Context Menu")) {
+        auto it = graph.nodes.find(context_node_id.Get());
+        if (it != graph.nodes.end()) {
+            ImGui::MenuItem("Preview", nullptr, &it->second->preview);
+        }
         if (ImGui::MenuItem("Delete")) {
             ed::DeleteNode(context_node_id);
         }
@@ -154,9 +303,26 @@ void App::update_and_draw() {
     // ---------------------------------------------------------------
     // draw nodes
     for (auto [_, node] : graph.nodes) {
+        // by the last frame layout, new nodes show their previews a frame later
+        ImVec2 position = ed::GetNodePosition(node->id);
+        ImVec2 size = ed::GetNodeSize(node->id);
+        bool is_visible = position.x < view_max.x && position.y < view_max.y
+                          && position.x + size.x > view_min.x
+                          && position.y + size.y > view_min.y;
+
         ed::BeginNode(node->id);
         ImGui::TextUnformatted(node->name.c_str());
 
+        auto timing = graph.profiler.timings.find(node->id);
+        if (graph.profiler.is_enabled && timing != graph.profiler.timings.end()) {
+            auto &t = timing->second;
+            if (t.n_gpu_frames) {
+                ImGui::TextDisabled("cpu %.2f ms, gpu %.2f ms", t.cpu_ms, t.gpu_ms);
+            } else {
+                ImGui::TextDisabled("cpu %.2f ms", t.cpu_ms);
+            }
+        }
+
         // input pins
         ImGui::BeginGroup();
         for (auto &pin : node->pins) {
@@ -186,6 +352,10 @@ void App::update_and_draw() {
                 case PinType::INT:
                     ImGui::SliderInt(name, &pin._int.val, pin._int.min, pin._int.max);
                     break;
+                case PinType::BOOL:
+                    // a toggle might change how the graph is compiled
+                    if (ImGui::Checkbox(name, &pin._bool)) graph.is_dirty = true;
+                    break;
                 case PinType::COLOR:
                     ImGui::ColorPicker3(name, reinterpret_cast<float *>(&pin._color));
                     break;
@@ -202,12 +372,22 @@ void App::update_and_draw() {
             if (pin.kind != PinKind::OUTPUT) continue;
             ed::BeginPin(pin.id, ed::PinKind::Output);
             ImGui::TextUnformatted(pin.name.c_str());
-            if (pin.type == PinType::TEXTURE && IsTextureReady(pin._texture)) {
-                int id = pin._texture.id;
-                float aspect = (float)pin._texture.width / pin._texture.height;
+            if (node->preview && pin.type == PinType::TEXTURE) {
+                // drawn from the output after the graph update, so a new
+                // preview shows up a frame later
                 float width = 200.0;
-                float height = width / aspect;
-                ImGui::Image((ImTextureID)(long)id, {width, height});
+                Texture texture = is_visible ? this->thumbnails.get(pin, width)
+                                             : this->thumbnails.find(pin.id);
+                if (IsTextureReady(texture)) {
+                    float height = width * texture.height / texture.width;
+                    if (is_visible) {
+                        ImGui::Image((ImTextureID)(long)texture.id, {width, height});
+                    } else {
+                        // keeps the node size, a shrunk node could flip its
+                        // visibility
+                        ImGui::Dummy({width, height});
+                    }
+                }
             }
             ed::EndPin();
         }
@@ -224,16 +404,31 @@ void App::update_and_draw() {
 
     // ---------------------------------------------------------------
     // update graph
+    ui_scope.reset();
+    reload_shaders(this->shader_watcher.take_changes());
+    this->thumbnails.prepare(graph);
     graph.update();
+    this->thumbnails.update(graph);
 
     // ---------------------------------------------------------------
     // finalize drawing
     ed::End();
     ed::SetCurrentEditor(nullptr);
 
-    ImGui::Render();
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    {
+        TraceScope scope("ui", "render");
+        ImGui::Render();
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        DrawFPS(0, 0);
+        if (this->is_latency_shown) draw_latency(graph.latency);
+    }
 
-    DrawFPS(0, 0);
+    // the buffer swap and the wait for the target fps
+    TraceScope scope("ui", "present");
     EndDrawing();
+
+    // the redrawn previews are on the screen now, with vsync at the latest
+    // on the next refresh
+    int64_t time = get_stamp_ns();
+    for (auto &stamp : this->thumbnails.take_stamps()) graph.latency.record(stamp, time);
 }
@@ -1,6 +1,7 @@
 #pragma once
 #include "graph.hpp"
 #include "imgui/imgui_node_editor.h"
+#include "watcher.hpp"
 
 namespace ed = ax::NodeEditor;
 
@@ -8,6 +9,15 @@ class App {
 private:
     ed::EditorContext *context;
     Graph graph;
+    // what the previews draw instead of the full frames
+    Thumbnails thumbnails;
+    // the edited shaders are reloaded without restarting
+    FileWatcher shader_watcher;
+    // p50 and p99 of the preview latency under the fps
+    bool is_latency_shown;
+    // off after a failed load, so that the exit doesn't overwrite the file
+    // with the empty graph, an explicit save turns it back on
+    bool is_autosaved;
 
 public:
     App();
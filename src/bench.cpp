@@ -0,0 +1,154 @@
+#include "cpu.hpp"
+#include "gl.hpp"
+#include "graph.hpp"
+#include "opencv2/core.hpp"
+#include "raylib/raylib.h"
+#include "uniforms.hpp"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+// Runs the cpu steps on a 4K frame at each precision and reports the time
+// per frame, the throughput and the memory traffic of the step input and
+// output (the conversions inserted by the compiler are included in the time).
+// Then compares the fragment and compute shaders of the gpu nodes with wide
+// gathers, the time includes waiting for the gpu.
+
+static const int WIDTH = 3840;
+static const int HEIGHT = 2160;
+static const int N_WARMUP = 3;
+static const int N_FRAMES = 20;
+
+static std::shared_ptr<Node> create_node(Graph &graph, const std::string &name) {
+    for (auto &factory : graph.node_factories) {
+        if (factory.name == name) return factory.create();
+    }
+    throw std::runtime_error("Unknown node: " + name);
+}
+
+static void bench_step(CpuBackend &backend, CpuStep &step, const char *name) {
+    const char *names[] = {"F32", "F16", "U16", "U8"};
+    auto kernel = step.nodes.front()->context->get_cpu_kernel();
+
+    cv::Mat frame(HEIGHT, WIDTH, CV_32FC3);
+    cv::randu(frame, 0.0f, 1.0f);
+
+    printf("%s\n", name);
+    printf("%-6s %10s %10s %10s %8s\n", "", "ms", "Mpx/s", "GB/s", "speedup");
+
+    double f32_ms = 0.0;
+    for (int i = 0; i < 4; ++i) {
+        auto precision = (CpuPrecision)i;
+        bool is_native = step.kind != CpuKernelKind::FRAME
+                         || kernel->supports(precision);
+        step.precision = is_native ? precision : CpuPrecision::F32;
+
+        // the input is stored at the benchmarked precision
+        int depth = get_depth(precision);
+        double unit = depth == CV_8U ? 255.0 : depth == CV_16U ? 65535.0 : 1.0;
+        cv::Mat src, dst;
+        frame.convertTo(src, depth, unit);
+
+        for (int j = 0; j < N_WARMUP; ++j) backend.run(step, src, dst);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int j = 0; j < N_FRAMES; ++j) backend.run(step, src, dst);
+        std::chrono::duration<double, std::milli> elapsed
+            = std::chrono::steady_clock::now() - start;
+
+        double ms = elapsed.count() / N_FRAMES;
+        double bytes = src.total() * src.elemSize() + dst.total() * dst.elemSize();
+        if (precision == CpuPrecision::F32) f32_ms = ms;
+
+        printf(
+            "%-6s %10.2f %10.1f %10.2f %7.2fx%s\n",
+            names[i],
+            ms,
+            WIDTH * HEIGHT / ms / 1e3,
+            bytes / ms / 1e6,
+            f32_ms / ms,
+            is_native ? "" : " (converted to F32)"
+        );
+    }
+    printf("\n");
+}
+
+static void bench_gpu_node(std::shared_ptr<Node> node, Texture frame, int n_samples) {
+    node->pins[0]._texture = frame;
+    get_pin(node->pins, "n_samples")._int.val = n_samples;
+    get_pin(node->pins, "radius")._int.val = 32;
+
+    printf("%s, %d samples, radius 32\n", node->name.c_str(), n_samples);
+    printf("%-9s %10s %10s %8s\n", "", "ms", "Mpx/s", "speedup");
+
+    double fragment_ms = 0.0;
+    for (bool is_compute : {false, true}) {
+        set_compute_enabled(is_compute);
+        for (int j = 0; j < N_WARMUP; ++j) node->context->update(node);
+        glFinish();
+
+        auto start = std::chrono::steady_clock::now();
+        for (int j = 0; j < N_FRAMES; ++j) node->context->update(node);
+        glFinish();
+        std::chrono::duration<double, std::milli> elapsed
+            = std::chrono::steady_clock::now() - start;
+
+        double ms = elapsed.count() / N_FRAMES;
+        if (!is_compute) fragment_ms = ms;
+        printf(
+            "%-9s %10.2f %10.1f %7.2fx\n",
+            is_compute ? "compute" : "fragment",
+            ms,
+            WIDTH * HEIGHT / ms / 1e3,
+            fragment_ms / ms
+        );
+    }
+    printf("\n");
+
+    set_compute_enabled(true);
+    node->context->release_targets();
+}
+
+int main() {
+    // the nodes load their shaders, so a gl context is needed
+    SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    SetTraceLogLevel(LOG_WARNING);
+    InitWindow(64, 64, "Freska Bench");
+
+    {
+        Graph graph;
+        CpuBackend &backend = *graph.cpu_backend;
+
+        CpuStep fused = {
+            {create_node(graph, "Color Correction"),
+             create_node(graph, "Pixelization"),
+             create_node(graph, "Color Correction")},
+            CpuKernelKind::POINTWISE};
+        bench_step(
+            backend, fused, "Color Correction -> Pixelization -> Color Correction"
+        );
+
+        CpuStep scale = {{create_node(graph, "Scale")}, CpuKernelKind::FRAME};
+        bench_step(backend, scale, "Scale 0.5");
+
+        CpuStep quantization = {
+            {create_node(graph, "Color Quantization")}, CpuKernelKind::FRAME};
+        bench_step(backend, quantization, "Color Quantization");
+
+        Image image = GenImageWhiteNoise(WIDTH, HEIGHT, 0.5);
+        Texture frame = LoadTextureFromImage(image);
+        UnloadImage(image);
+        update_frame_uniforms(0.0, 0);
+        for (auto name : {"Color Quantization", "Color Outline"}) {
+            auto node = create_node(graph, name);
+            bench_gpu_node(node, frame, 16);
+            bench_gpu_node(node, frame, 87);
+        }
+        UnloadTexture(frame);
+    }
+
+    set_gl_closed();
+    CloseWindow();
+}
@@ -0,0 +1,1321 @@
+#include "cpu.hpp"
+
+#include "noise.hpp"
+#include "opencv2/core/hal/intrin.hpp"
+#include "opencv2/core/mat.hpp"
+#include "opencv2/core/utility.hpp"
+#include "opencv2/imgproc.hpp"
+#include "raylib/raylib.h"
+#include "raylib/rlgl.h"
+#include "trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+
+// -----------------------------------------------------------------------
+// utils
+static thread_local int MAX_THREADS = 0;
+
+void set_max_threads(int max_threads) {
+    MAX_THREADS = max_threads;
+}
+
+// the stripes run on the thread pool of opencv, so a call starts no threads
+void parallel_for(int n, const std::function<void(int, int)> &fn) {
+    int n_stripes = MAX_THREADS ? MAX_THREADS : cv::getNumThreads();
+    n_stripes = std::clamp(n_stripes, 1, std::max(n, 1));
+
+    auto run_stripes = [&](const cv::Range &range) {
+        for (int i = range.start; i < range.end; ++i) {
+            fn(i * n / n_stripes, (i + 1) * n / n_stripes);
+        }
+    };
+    cv::parallel_for_(cv::Range(0, n_stripes), run_stripes, n_stripes);
+}
+
+int get_depth(CpuPrecision precision) {
+    switch (precision) {
+        case CpuPrecision::F32: return CV_32F;
+        case CpuPrecision::F16: return CV_16F;
+        case CpuPrecision::U16: return CV_16U;
+        case CpuPrecision::U8: return CV_8U;
+    }
+    return CV_32F;
+}
+
+// value of 1.0 at the frame depth
+static double get_unit(int depth) {
+    switch (depth) {
+        case CV_8U: return 255.0;
+        case CV_16U: return 65535.0;
+        default: return 1.0;
+    }
+}
+
+void convert_frame(const cv::Mat &src, cv::Mat &dst, int depth) {
+    src.convertTo(dst, depth, get_unit(depth) / get_unit(src.depth()));
+}
+
+static void upload_texture(Texture &texture, const cv::Mat &frame) {
+    if (texture.id != 0
+        && (texture.width != frame.cols || texture.height != frame.rows)) {
+        UnloadTexture(texture);
+        texture.id = 0;
+    }
+
+    if (texture.id == 0) {
+        texture = {
+            .id = rlLoadTexture(
+                0, frame.cols, frame.rows, RL_PIXELFORMAT_UNCOMPRESSED_R8G8B8, 1
+            ),
+            .width = frame.cols,
+            .height = frame.rows,
+            .mipmaps = 1,
+            .format = RL_PIXELFORMAT_UNCOMPRESSED_R8G8B8};
+    }
+
+    cv::Mat rgb = frame;
+    if (frame.depth() != CV_8U) convert_frame(frame, rgb, CV_8U);
+    UpdateTexture(texture, rgb.data);
+}
+
+// nearest texel of a GL_REPEAT texture
+static inline int get_texel(float u, int size) {
+    int i = std::floor((u - std::floor(u)) * size);
+    return std::min(i, size - 1);
+}
+
+template <typename T = float>
+static inline const T *sample(const cv::Mat &frame, float u, float v) {
+    int x = get_texel(u, frame.cols);
+    int y = get_texel(v, frame.rows);
+    return frame.ptr<T>(y) + 3 * x;
+}
+
+// -----------------------------------------------------------------------
+// common.glsl port
+static const float BOX_BLUR_SCALE = 0.433f;
+
+static const float POISSON_DISK[87][2] = {
+    {-0.488690f, 0.046349f}, {0.496064f, 0.018367f}, {-0.027347f, -0.461505f},
+    {-0.090074f, 0.490283f}, {0.294474f, 0.366950f}, {0.305608f, -0.360041f},
+    {-0.346198f, -0.357278f}, {-0.308924f, 0.353038f}, {-0.437547f, -0.177748f},
+    {0.446996f, -0.129850f}, {0.117621f, -0.444649f}, {0.171424f, 0.418258f},
+    {-0.227789f, -0.410446f}, {0.210264f, -0.422608f}, {-0.414136f, -0.268376f},
+    {0.368202f, 0.316549f}, {-0.480689f, 0.127069f}, {0.481128f, -0.056358f},
+    {-0.458004f, -0.063002f}, {0.409361f, 0.201972f}, {-0.176597f, 0.424044f},
+    {-0.095380f, -0.441734f}, {0.326086f, -0.280594f}, {-0.411327f, 0.184757f},
+    {-0.291534f, -0.300406f}, {0.400901f, -0.002308f}, {0.020255f, 0.445511f},
+    {0.302251f, 0.275637f}, {0.387805f, -0.223370f}, {-0.378395f, 0.062614f},
+    {0.405052f, 0.101681f}, {-0.010340f, -0.355322f}, {-0.034931f, 0.383699f},
+    {-0.318953f, -0.225899f}, {0.349283f, -0.140001f}, {-0.253974f, 0.299183f},
+    {0.188226f, 0.342914f}, {0.212083f, -0.294545f}, {-0.188320f, -0.308466f},
+    {-0.373708f, -0.070538f}, {0.114322f, -0.356677f}, {-0.154401f, 0.348207f},
+    {-0.321713f, 0.260043f}, {-0.086797f, -0.349277f}, {-0.360294f, -0.144808f},
+    {-0.323996f, 0.188199f}, {0.277830f, -0.204128f}, {0.087828f, 0.351992f},
+    {-0.215777f, -0.234955f}, {0.291437f, 0.171860f}, {0.027249f, -0.255925f},
+    {-0.316361f, -0.013941f}, {0.346679f, -0.066942f}, {-0.103280f, -0.273636f},
+    {-0.017802f, 0.310973f}, {-0.280809f, -0.120043f}, {-0.282912f, 0.117500f},
+    {0.267574f, -0.036973f}, {-0.034965f, -0.223502f}, {0.109677f, 0.256372f},
+    {-0.204519f, -0.116846f}, {0.144105f, -0.181736f}, {-0.140560f, 0.215101f},
+    {0.271573f, 0.102406f}, {0.220437f, 0.203459f}, {-0.242979f, -0.027494f},
+    {-0.050135f, 0.239871f}, {-0.152652f, -0.193125f}, {-0.220532f, 0.179600f},
+    {0.216867f, -0.096770f}, {-0.164884f, 0.122109f}, {0.251078f, 0.034090f},
+    {0.016515f, -0.175206f}, {0.042304f, 0.216117f}, {-0.133933f, -0.060601f},
+    {0.184659f, 0.135680f}, {-0.161273f, 0.024207f}, {-0.056532f, -0.154410f},
+    {-0.082706f, 0.083129f}, {0.081409f, -0.088060f}, {0.115078f, 0.156566f},
+    {0.133209f, 0.061211f}, {0.002618f, -0.101328f}, {0.132926f, -0.013988f},
+    {-0.027172f, -0.017586f}, {0.022969f, 0.116469f}, {0.036262f, 0.015085f},
+};
+
+static inline float fract(float x) {
+    return x - std::floor(x);
+}
+
+// window offset and rotation of the poisson disc taps, see common.glsl
+class PoissonDisc {
+public:
+    int offset;
+    float cos_;
+    float sin_;
+
+    PoissonDisc(float noise) {
+        offset = noise * 87.0f;
+        float angle = 2.0f * PI * fract(noise * 87.0f);
+        cos_ = std::cos(angle);
+        sin_ = std::sin(angle);
+    }
+
+    inline void get(int idx, float &x, float &y) const {
+        const float *p = POISSON_DISK[(offset + idx) % 87];
+        x = cos_ * p[0] - sin_ * p[1];
+        y = sin_ * p[0] + cos_ * p[1];
+    }
+};
+
+static inline float srgb2linear(float c) {
+    return c > 0.04045f ? std::pow((c + 0.055f) / 1.055f, 2.4f) : c / 12.92f;
+}
+
+static inline float linear2srgb(float c) {
+    return c > 0.0031308f ? 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f : 12.92f * c;
+}
+
+static inline float lab_f(float t) {
+    return t > 0.008856f ? std::cbrt(t) : 7.787f * t + 16.0f / 116.0f;
+}
+
+static inline float lab_f_inv(float t) {
+    return t > 0.206897f ? t * t * t : (t - 16.0f / 116.0f) / 7.787f;
+}
+
+static cv::Vec3f rgb2lab(cv::Vec3f c) {
+    float r = srgb2linear(c[0]);
+    float g = srgb2linear(c[1]);
+    float b = srgb2linear(c[2]);
+
+    float x = 100.0f * (0.4124f * r + 0.3576f * g + 0.1805f * b) / 95.047f;
+    float y = 100.0f * (0.2126f * r + 0.7152f * g + 0.0722f * b) / 100.0f;
+    float z = 100.0f * (0.0193f * r + 0.1192f * g + 0.9505f * b) / 108.883f;
+
+    x = lab_f(x);
+    y = lab_f(y);
+    z = lab_f(z);
+
+    float l = 116.0f * y - 16.0f;
+    float a = 500.0f * (x - y);
+    float b_ = 200.0f * (y - z);
+    return {l / 100.0f, 0.5f + 0.5f * (a / 127.0f), 0.5f + 0.5f * (b_ / 127.0f)};
+}
+
+static cv::Vec3f lab2rgb(cv::Vec3f c) {
+    float l = 100.0f * c[0];
+    float a = 2.0f * 127.0f * (c[1] - 0.5f);
+    float b = 2.0f * 127.0f * (c[2] - 0.5f);
+
+    float fy = (l + 16.0f) / 116.0f;
+    float fx = a / 500.0f + fy;
+    float fz = fy - b / 200.0f;
+
+    float x = 95.047f * lab_f_inv(fx) / 100.0f;
+    float y = 100.000f * lab_f_inv(fy) / 100.0f;
+    float z = 108.883f * lab_f_inv(fz) / 100.0f;
+
+    return {
+        linear2srgb(3.2406f * x - 1.5372f * y - 0.4986f * z),
+        linear2srgb(-0.9689f * x + 1.8758f * y + 0.0415f * z),
+        linear2srgb(0.0557f * x - 0.2040f * y + 1.0570f * z)};
+}
+
+static cv::Vec3f rgb2hsv(cv::Vec3f c) {
+    float r = c[0], g = c[1], b = c[2];
+    float p[4], q[4];
+    if (g >= b) {
+        p[0] = g, p[1] = b, p[2] = 0.0f, p[3] = -1.0f / 3.0f;
+    } else {
+        p[0] = b, p[1] = g, p[2] = -1.0f, p[3] = 2.0f / 3.0f;
+    }
+    if (r >= p[0]) {
+        q[0] = r, q[1] = p[1], q[2] = p[2], q[3] = p[0];
+    } else {
+        q[0] = p[0], q[1] = p[1], q[2] = p[3], q[3] = r;
+    }
+
+    float d = q[0] - std::min(q[3], q[1]);
+    float e = 1.0e-10f;
+    return {std::abs(q[2] + (q[3] - q[1]) / (6.0f * d + e)), d / (q[0] + e), q[0]};
+}
+
+static cv::Vec3f hsv2rgb(cv::Vec3f c) {
+    const float k[3] = {1.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+    cv::Vec3f rgb;
+    for (int i = 0; i < 3; ++i) {
+        float p = std::abs(fract(c[0] + k[i]) * 6.0f - 3.0f);
+        p = std::clamp(p - 1.0f, 0.0f, 1.0f);
+        rgb[i] = c[2] * (1.0f + (p - 1.0f) * c[1]);
+    }
+    return rgb;
+}
+
+static cv::Vec3f quantize_color(cv::Vec3f color, float n_levels) {
+    if (n_levels == 0.0f) return color;
+
+    cv::Vec3f hsv = rgb2hsv(color);
+    hsv[0] = std::round(hsv[0] * n_levels) / n_levels;
+    hsv[2] = std::round(hsv[2] * n_levels) / n_levels;
+    return hsv2rgb(hsv);
+}
+
+// -----------------------------------------------------------------------
+// old_tv.frag simplex noise port
+// Written once for float and for cv::v_float32x4, so the per-pixel noise
+// runs on 4 pixels at a time.
+template <typename T> static inline T splat(float x);
+
+template <> inline float splat<float>(float x) {
+    return x;
+}
+
+template <> inline cv::v_float32x4 splat<cv::v_float32x4>(float x) {
+    return cv::v_setall_f32(x);
+}
+
+static inline float floor_(float x) {
+    return std::floor(x);
+}
+
+static inline cv::v_float32x4 floor_(cv::v_float32x4 x) {
+    return cv::v_cvt_f32(cv::v_floor(x));
+}
+
+static inline float abs_(float x) {
+    return std::abs(x);
+}
+
+static inline cv::v_float32x4 abs_(cv::v_float32x4 x) {
+    return cv::v_abs(x);
+}
+
+static inline float max_(float a, float b) {
+    return std::max(a, b);
+}
+
+static inline cv::v_float32x4 max_(cv::v_float32x4 a, cv::v_float32x4 b) {
+    return cv::v_max(a, b);
+}
+
+static inline float select_(bool mask, float a, float b) {
+    return mask ? a : b;
+}
+
+static inline cv::v_float32x4 select_(
+    cv::v_float32x4 mask, cv::v_float32x4 a, cv::v_float32x4 b
+) {
+    return cv::v_select(mask, a, b);
+}
+
+template <typename T> static inline T mod289(T x) {
+    return x - floor_(x * splat<T>(1.0f / 289.0f)) * splat<T>(289.0f);
+}
+
+template <typename T> static inline T permute(T x) {
+    return mod289((x * splat<T>(34.0f) + splat<T>(1.0f)) * x);
+}
+
+// contribution of a single simplex corner
+template <typename T> static inline T snoise_corner(T p, T x, T y) {
+    const T zero = splat<T>(0.0f), half = splat<T>(0.5f);
+    const T one = splat<T>(1.0f), two = splat<T>(2.0f);
+
+    T m = max_(half - (x * x + y * y), zero);
+    m = m * m;
+    m = m * m;
+
+    T gx = p * splat<T>(0.024390243902439f);
+    gx = two * (gx - floor_(gx)) - one;
+    T h = abs_(gx) - half;
+    T a0 = gx - floor_(gx + half);
+
+    // approximation of inversesqrt(a0 * a0 + h * h)
+    T norm = splat<T>(1.79284291400159f)
+             - splat<T>(0.85373472095314f) * (a0 * a0 + h * h);
+    m = m * norm;
+    return m * (a0 * x + h * y);
+}
+
+template <typename T> static T snoise(T vx, T vy) {
+    const T cx = splat<T>(0.211324865405187f);
+    const T cy = splat<T>(0.366025403784439f);
+    const T cz = splat<T>(-0.577350269189626f);
+    const T zero = splat<T>(0.0f), one = splat<T>(1.0f);
+
+    T s = (vx + vy) * cy;
+    T ix = floor_(vx + s);
+    T iy = floor_(vy + s);
+    T t = (ix + iy) * cx;
+    T x0 = vx - ix + t;
+    T y0 = vy - iy + t;
+
+    auto is_x_major = x0 > y0;
+    T i1x = select_(is_x_major, one, zero);
+    T i1y = select_(is_x_major, zero, one);
+
+    ix = mod289(ix);
+    iy = mod289(iy);
+    T p0 = permute(permute(iy) + ix);
+    T p1 = permute(permute(iy + i1y) + ix + i1x);
+    T p2 = permute(permute(iy + one) + ix + one);
+
+    T n = snoise_corner(p0, x0, y0);
+    n = n + snoise_corner(p1, x0 + cx - i1x, y0 + cx - i1y);
+    n = n + snoise_corner(p2, x0 + cz, y0 + cz);
+    return splat<T>(130.0f) * n;
+}
+
+// Separable box blur with running sums, so the cost doesn't depend on r.
+// Taps outside of the frame are skipped, same as in sample_texture.
+void box_blur(const cv::Mat &src, cv::Mat &dst, int r) {
+    int width = src.cols;
+    int height = src.rows;
+    cv::Mat tmp(src.size(), CV_32FC3);
+    dst.create(src.size(), CV_32FC3);
+
+    parallel_for(height, [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            const float *src_row = src.ptr<float>(y);
+            float *tmp_row = tmp.ptr<float>(y);
+            float sum[3] = {0.0f, 0.0f, 0.0f};
+            int n = 0;
+
+            for (int x = 0; x < std::min(r, width); ++x, ++n) {
+                for (int c = 0; c < 3; ++c) sum[c] += src_row[3 * x + c];
+            }
+
+            for (int x = 0; x < width; ++x) {
+                if (x + r < width) {
+                    for (int c = 0; c < 3; ++c) sum[c] += src_row[3 * (x + r) + c];
+                    n += 1;
+                }
+                if (x - r - 1 >= 0) {
+                    for (int c = 0; c < 3; ++c) sum[c] -= src_row[3 * (x - r - 1) + c];
+                    n -= 1;
+                }
+                for (int c = 0; c < 3; ++c) tmp_row[3 * x + c] = sum[c] / n;
+            }
+        }
+    });
+
+    parallel_for(height, [&](int y0, int y1) {
+        int row_size = 3 * width;
+        std::vector<float> sum(row_size, 0.0f);
+        int n = 0;
+
+        auto add_row = [&](int y, float sign) {
+            const float *tmp_row = tmp.ptr<float>(y);
+            for (int i = 0; i < row_size; ++i) sum[i] += sign * tmp_row[i];
+        };
+
+        // start with the window of the row above y0
+        int begin = std::max(0, y0 - r - 1);
+        int end = std::min(height, y0 + r);
+        for (int y = begin; y < end; ++y, ++n) {
+            add_row(y, 1.0f);
+        }
+
+        for (int y = y0; y < y1; ++y) {
+            if (y + r < height) {
+                add_row(y + r, 1.0f);
+                n += 1;
+            }
+            if (y - r - 1 >= 0) {
+                add_row(y - r - 1, -1.0f);
+                n -= 1;
+            }
+
+            float *dst_row = dst.ptr<float>(y);
+            for (int i = 0; i < row_size; ++i) dst_row[i] = sum[i] / n;
+        }
+    });
+}
+
+// Running max over [x - r, x + r] along the rows by van Herk/Gil-Werman:
+// prefix and suffix maxima over blocks of 2r + 1, three comparisons per
+// pixel whatever r is
+static void max_filter_rows(const cv::Mat &src, cv::Mat &dst, int r) {
+    int width = src.cols;
+    int k = 2 * r + 1;
+    int size = (width + 2 * r + k - 1) / k * k;
+
+    dst.create(src.size(), CV_32F);
+    parallel_for(src.rows, [&](int y0, int y1) {
+        std::vector<float> f(size, std::numeric_limits<float>::lowest());
+        std::vector<float> g(size), h(size);
+
+        for (int y = y0; y < y1; ++y) {
+            const float *src_row = src.ptr<float>(y);
+            float *dst_row = dst.ptr<float>(y);
+            std::copy(src_row, src_row + width, f.begin() + r);
+
+            for (int b = 0; b < size; b += k) {
+                g[b] = f[b];
+                for (int i = b + 1; i < b + k; ++i) g[i] = std::max(g[i - 1], f[i]);
+                h[b + k - 1] = f[b + k - 1];
+                for (int i = b + k - 2; i >= b; --i) h[i] = std::max(h[i + 1], f[i]);
+            }
+
+            for (int x = 0; x < width; ++x) {
+                dst_row[x] = std::max(h[x], g[x + 2 * r]);
+            }
+        }
+    });
+}
+
+void max_filter(const cv::Mat &src, cv::Mat &dst, int r) {
+    cv::Mat rows, rows_t, cols_t;
+    max_filter_rows(src, rows, r);
+    cv::transpose(rows, rows_t);
+    max_filter_rows(rows_t, cols_t, r);
+    cv::transpose(cols_t, dst);
+}
+
+// -----------------------------------------------------------------------
+// remap
+RemapTable::RemapTable()
+    : version(0) {}
+
+bool RemapTable::update(
+    const std::vector<float> &params,
+    int width,
+    int height,
+    const std::function<void(float *, float *, int)> &map
+) {
+    if (version != 0 && params == this->params && uv.cols == width
+        && uv.rows == height) {
+        return false;
+    }
+
+    this->params = params;
+    uv.create(height, width, CV_32FC3);
+    cv::Mat map_x(height, width, CV_32F);
+    cv::Mat map_y(height, width, CV_32F);
+
+    parallel_for(height, [&](int y0, int y1) {
+        std::vector<float> u(width), v(width);
+        for (int y = y0; y < y1; ++y) {
+            for (int x = 0; x < width; ++x) {
+                u[x] = (x + 0.5f) / width;
+                v[x] = (y + 0.5f) / height;
+            }
+            map(u.data(), v.data(), width);
+
+            auto uv_row = uv.ptr<cv::Vec3f>(y);
+            float *map_x_row = map_x.ptr<float>(y);
+            float *map_y_row = map_y.ptr<float>(y);
+            for (int x = 0; x < width; ++x) {
+                uv_row[x] = {u[x], v[x], 0.0f};
+                map_x_row[x] = u[x] * width - 0.5f;
+                map_y_row[x] = v[x] * height - 0.5f;
+            }
+        }
+    });
+
+    // fixed-point coordinates plus interpolation weight indices
+    cv::convertMaps(map_x, map_y, map_xy, map_weights, CV_16SC2);
+    version += 1;
+    return true;
+}
+
+void RemapTable::apply(const cv::Mat &src, cv::Mat &dst) {
+    // BORDER_WRAP matches GL_REPEAT
+    cv::remap(src, dst, map_xy, map_weights, cv::INTER_LINEAR, cv::BORDER_WRAP);
+}
+
+// -----------------------------------------------------------------------
+// kernels
+CpuKernel::CpuKernel(CpuKernelKind kind)
+    : kind(kind)
+    , frame_idx(0)
+    , time(0.0f) {}
+
+bool CpuKernel::supports(CpuPrecision precision) {
+    return precision == CpuPrecision::F32;
+}
+
+CpuKernelKind CpuKernel::get_kind(std::vector<Pin> &pins) {
+    return kind;
+}
+
+WarpKernel::WarpKernel()
+    : CpuKernel(CpuKernelKind::GATHER) {}
+
+CpuKernelKind WarpKernel::get_kind(std::vector<Pin> &pins) {
+    return get_pin(pins, "cached_remap")._bool ? CpuKernelKind::FRAME
+                                                : CpuKernelKind::GATHER;
+}
+
+// cv::remap takes any depth but f16
+bool WarpKernel::supports(CpuPrecision precision) {
+    return precision != CpuPrecision::F16;
+}
+
+void WarpKernel::update_table(int width, int height) {
+    table.update(get_params(), width, height, [&](float *u, float *v, int n) {
+        map(u, v, n, width, height);
+    });
+}
+
+void WarpKernel::process(const cv::Mat &src, cv::Mat &dst) {
+    update_table(src.cols, src.rows);
+    table.apply(src, dst);
+}
+
+SourceKernel::SourceKernel(std::function<void(cv::Mat &, FrameStamp &)> read)
+    : CpuKernel(CpuKernelKind::SOURCE)
+    , read(read)
+    , pins(nullptr) {}
+
+// sources emit their native precision, the consumers convert it if needed
+bool SourceKernel::supports(CpuPrecision precision) {
+    return true;
+}
+
+void SourceKernel::prepare(std::vector<Pin> &pins) {
+    this->pins = &pins;
+}
+
+void SourceKernel::process(const cv::Mat &src, cv::Mat &dst) {
+    read(dst, this->pins->back().stamp);
+}
+
+SinkKernel::SinkKernel(std::function<void(std::vector<Pin> &, const cv::Mat &)> write)
+    : CpuKernel(CpuKernelKind::FRAME)
+    , write(write)
+    , pins(nullptr) {}
+
+bool SinkKernel::supports(CpuPrecision precision) {
+    return true;
+}
+
+void SinkKernel::prepare(std::vector<Pin> &pins) {
+    this->pins = &pins;
+}
+
+void SinkKernel::process(const cv::Mat &src, cv::Mat &dst) {
+    dst = src;
+    if (!src.empty()) write(*this->pins, src);
+}
+
+ColorCorrectionKernel::ColorCorrectionKernel()
+    : CpuKernel(CpuKernelKind::POINTWISE) {}
+
+void ColorCorrectionKernel::prepare(std::vector<Pin> &pins) {
+    white_balance = get_pin(pins, "white_balance")._color;
+    exposure = get_pin(pins, "exposure")._float.val;
+    temperature = get_pin(pins, "temperature")._float.val;
+    contrast = get_pin(pins, "contrast")._float.val;
+    brightness = get_pin(pins, "brightness")._float.val;
+    saturation = get_pin(pins, "saturation")._float.val;
+    gamma = get_pin(pins, "gamma")._float.val;
+}
+
+void ColorCorrectionKernel::apply(float *rgb, int n) {
+    const float wb[3] = {white_balance.x, white_balance.y, white_balance.z};
+    for (int i = 0; i < n; ++i) {
+        cv::Vec3f color(rgb + 3 * i);
+
+        for (int c = 0; c < 3; ++c) {
+            if (exposure >= 0.0f) color[c] = 1.0f - std::exp(-color[c] * exposure);
+            color[c] = std::pow(std::pow(color[c], 2.2f) * wb[c], 1.0f / 2.2f);
+        }
+
+        color = lab2rgb(rgb2lab(color) * temperature);
+
+        for (int c = 0; c < 3; ++c) {
+            color[c] = std::pow(color[c], contrast);
+            color[c] = std::clamp(color[c] + brightness, 0.0f, 1.0f);
+        }
+
+        cv::Vec3f hsv = rgb2hsv(color);
+        hsv[1] *= saturation;
+        color = hsv2rgb(hsv);
+
+        for (int c = 0; c < 3; ++c) {
+            rgb[3 * i + c] = std::pow(color[c], 1.0f / gamma);
+        }
+    }
+}
+
+ColorQuantizationKernel::ColorQuantizationKernel(std::function<int()> get_proxy_scale)
+    : CpuKernel(CpuKernelKind::FRAME)
+    , get_proxy_scale(get_proxy_scale) {}
+
+void ColorQuantizationKernel::prepare(std::vector<Pin> &pins) {
+    n_levels = get_pin(pins, "n_levels")._int.val;
+    n_samples = get_pin(pins, "n_samples")._int.val;
+    radius = get_proxy_pixels(get_pin(pins, "radius")._int.val, get_proxy_scale());
+    fast_blur = get_pin(pins, "fast_blur")._bool;
+    bool temporal_noise = get_pin(pins, "temporal_noise")._bool;
+    noise_frame = temporal_noise ? frame_idx : 0;
+}
+
+void ColorQuantizationKernel::process(const cv::Mat &src, cv::Mat &dst) {
+    int width = src.cols;
+    int height = src.rows;
+    float levels = n_levels;
+    dst.create(src.size(), CV_32FC3);
+
+    if (fast_blur) {
+        box_blur(src, dst, std::round(BOX_BLUR_SCALE * radius));
+        parallel_for(height, [&](int y0, int y1) {
+            for (int y = y0; y < y1; ++y) {
+                auto dst_row = dst.ptr<cv::Vec3f>(y);
+                for (int x = 0; x < width; ++x) {
+                    dst_row[x] = quantize_color(dst_row[x], levels);
+                }
+            }
+        });
+        return;
+    }
+
+    const BlueNoise &blue_noise = get_blue_noise();
+    parallel_for(height, [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            float *dst_row = dst.ptr<float>(y);
+            float v = (y + 0.5f) / height;
+
+            for (int x = 0; x < width; ++x) {
+                float u = (x + 0.5f) / width;
+                PoissonDisc disc(blue_noise.get(x, y, noise_frame));
+
+                cv::Vec3f color(0.0f, 0.0f, 0.0f);
+                float n = 0.0f;
+                for (int i = 0; i < n_samples; ++i) {
+                    float disc_x, disc_y;
+                    disc.get(i, disc_x, disc_y);
+                    float u_ = u + radius * disc_x / width;
+                    float v_ = v + radius * disc_y / height;
+                    if (u_ >= 0.0f && u_ <= 1.0f && v_ >= 0.0f && v_ <= 1.0f) {
+                        color += cv::Vec3f(sample(src, u_, v_));
+                        n += 1.0f;
+                    }
+                }
+                color = quantize_color(color / n, levels);
+                std::memcpy(dst_row + 3 * x, color.val, sizeof(color.val));
+            }
+        }
+    });
+}
+
+ColorOutlineKernel::ColorOutlineKernel(std::function<int()> get_proxy_scale)
+    : CpuKernel(CpuKernelKind::FRAME)
+    , get_proxy_scale(get_proxy_scale) {}
+
+void ColorOutlineKernel::prepare(std::vector<Pin> &pins) {
+    color = get_pin(pins, "color")._color;
+    threshold = get_pin(pins, "threshold")._float.val;
+    n_samples = get_pin(pins, "n_samples")._int.val;
+    radius = get_proxy_pixels(get_pin(pins, "radius")._int.val, get_proxy_scale());
+    fast_outline = get_pin(pins, "fast_outline")._bool;
+    bool temporal_noise = get_pin(pins, "temporal_noise")._bool;
+    noise_frame = temporal_noise ? frame_idx : 0;
+}
+
+void ColorOutlineKernel::process_fast(const cv::Mat &src, cv::Mat &dst) {
+    int width = src.cols;
+    int height = src.rows;
+
+    // hsv value plane
+    cv::Mat value(src.size(), CV_32F);
+    parallel_for(height, [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            auto src_row = src.ptr<cv::Vec3f>(y);
+            float *value_row = value.ptr<float>(y);
+            for (int x = 0; x < width; ++x) {
+                cv::Vec3f rgb = src_row[x];
+                value_row[x] = std::max(rgb[0], std::max(rgb[1], rgb[2]));
+            }
+        }
+    });
+
+    // Scharr magnitude, a step of height d gives d like in outline_edges.frag
+    cv::Mat gx, gy, magnitude, edges;
+    cv::Scharr(value, gx, CV_32F, 1, 0, 1.0 / 16.0, 0.0, cv::BORDER_REPLICATE);
+    cv::Scharr(value, gy, CV_32F, 0, 1, 1.0 / 16.0, 0.0, cv::BORDER_REPLICATE);
+    cv::magnitude(gx, gy, magnitude);
+    max_filter(magnitude, edges, (radius + 1) / 2);
+
+    parallel_for(height, [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            auto src_row = src.ptr<cv::Vec3f>(y);
+            auto dst_row = dst.ptr<cv::Vec3f>(y);
+            const float *edges_row = edges.ptr<float>(y);
+            for (int x = 0; x < width; ++x) {
+                bool is_outline = edges_row[x] > threshold;
+                dst_row[x] = is_outline ? cv::Vec3f(color.x, color.y, color.z)
+                                        : src_row[x];
+            }
+        }
+    });
+}
+
+void ColorOutlineKernel::process(const cv::Mat &src, cv::Mat &dst) {
+    dst.create(src.size(), CV_32FC3);
+    if (fast_outline) {
+        process_fast(src, dst);
+        return;
+    }
+
+    int width = src.cols;
+    int height = src.rows;
+
+    // the hsv value is just the max channel
+    auto get_value = [](const float *rgb) {
+        return std::max(rgb[0], std::max(rgb[1], rgb[2]));
+    };
+
+    const BlueNoise &blue_noise = get_blue_noise();
+    parallel_for(height, [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            const float *src_row = src.ptr<float>(y);
+            float *dst_row = dst.ptr<float>(y);
+            float v = (y + 0.5f) / height;
+
+            for (int x = 0; x < width; ++x) {
+                float u = (x + 0.5f) / width;
+                PoissonDisc disc(blue_noise.get(x, y, noise_frame));
+
+                float prev_value = get_value(src_row + 3 * x);
+                float max_dist = 0.0f;
+                for (int i = 0; i < n_samples; ++i) {
+                    float disc_x, disc_y;
+                    disc.get(i, disc_x, disc_y);
+                    float u_ = u + radius * disc_x / width;
+                    float v_ = v + radius * disc_y / height;
+                    if (u_ >= 0.0f && u_ <= 1.0f && v_ >= 0.0f && v_ <= 1.0f) {
+                        float curr_value = get_value(sample(src, u_, v_));
+                        max_dist = std::max(max_dist, std::abs(prev_value - curr_value));
+                        prev_value = curr_value;
+                    }
+                }
+
+                const float *rgb = src_row + 3 * x;
+                bool is_outline = max_dist > threshold;
+                dst_row[3 * x + 0] = is_outline ? color.x : rgb[0];
+                dst_row[3 * x + 1] = is_outline ? color.y : rgb[1];
+                dst_row[3 * x + 2] = is_outline ? color.z : rgb[2];
+            }
+        }
+    });
+}
+
+OldTvKernel::OldTvKernel()
+    : CpuKernel(CpuKernelKind::FRAME) {}
+
+void OldTvKernel::prepare(std::vector<Pin> &pins) {
+    vert_jerk = get_pin(pins, "vert_jerk")._float.val;
+    vert_movement = get_pin(pins, "vert_movement")._float.val;
+    bottom_static = get_pin(pins, "bottom_static")._float.val;
+    scanlines = get_pin(pins, "scanlines")._float.val;
+    rgb_offset = get_pin(pins, "rgb_offset")._float.val;
+    horz_fuzz = get_pin(pins, "horz_fuzz")._float.val;
+}
+
+void OldTvKernel::process(const cv::Mat &src, cv::Mat &dst) {
+    using cv::v_float32x4;
+
+    int width = src.cols;
+    int height = src.rows;
+    float t = time;
+    dst.create(src.size(), CV_32FC3);
+
+    // everything which depends only on time
+    float static_height = snoise(9.0f, t * 1.2f + 3.0f) * 0.3f + 5.0f;
+    float static_amount = snoise(1.0f, t * 1.2f - 6.0f) * 0.1f + 0.3f;
+    float static_strength = snoise(-9.75f, t * 0.6f - 3.0f) * 2.0f + 2.0f;
+    float vert_movement_on = (snoise(t * 0.2f, 8.0f) > 0.4f) * vert_movement;
+    float vert_jerk_1 = (snoise(t * 1.5f, 5.0f) > 0.6f) * vert_jerk;
+    float vert_jerk_2 = (snoise(t * 5.5f, 5.0f) > 0.2f) * vert_jerk;
+    float y_offset = std::abs(std::sin(t) * 4.0f) * vert_movement_on
+                     + vert_jerk_1 * vert_jerk_2 * 0.3f;
+    float static_time = t - 100.0f * std::floor(t / 100.0f) + 100.0f;
+    bool has_static = bottom_static != 0.0f;
+
+    // static noise x argument depends only on the column
+    std::vector<float> static_x(width);
+    for (int x = 0; x < width; ++x) {
+        float u = (x + 0.5f) / width;
+        static_x[x] = 5.0f * t * t + std::pow(u * 7.0f, 1.2f);
+    }
+
+    parallel_for(height, [&](int y0, int y1) {
+        std::vector<float> static_val(width);
+
+        for (int y = y0; y < y1; ++y) {
+            // everything which depends only on the row
+            float v = (y + 0.5f) / height;
+            float fuzz_offset = snoise(t * 15.0f, v * 80.0f) * 0.003f;
+            float large_fuzz_offset = snoise(t, v * 25.0f) * 0.004f;
+            float x_offset = (fuzz_offset + large_fuzz_offset) * horz_fuzz;
+            float src_v = fract(v + y_offset);
+            float scanline = std::sin(v * 800.0f) * 0.04f * scanlines;
+
+            std::fill(static_val.begin(), static_val.end(), 0.0f);
+            for (int i = -1; has_static && i <= 1; ++i) {
+                float dist = i / 200.0f;
+                float weight = (5.0f / 200.0f - std::abs(dist)) * 1.5f;
+                weight *= static_strength * bottom_static;
+                float static_y = std::pow(
+                    static_time * (v + dist) * 0.3f + 3.0f, static_height
+                );
+
+                int x = 0;
+                v_float32x4 vy = cv::v_setall_f32(static_y);
+                v_float32x4 amount = cv::v_setall_f32(static_amount);
+                v_float32x4 vweight = cv::v_setall_f32(weight);
+                v_float32x4 zero = cv::v_setall_f32(0.0f);
+                for (; x + 4 <= width; x += 4) {
+                    v_float32x4 noise = snoise(cv::v_load(&static_x[x]), vy);
+                    v_float32x4 val = cv::v_select(noise > amount, vweight, zero);
+                    cv::v_store(&static_val[x], cv::v_load(&static_val[x]) + val);
+                }
+                for (; x < width; ++x) {
+                    static_val[x] += (snoise(static_x[x], static_y) > static_amount)
+                                     * weight;
+                }
+            }
+
+            float *dst_row = dst.ptr<float>(y);
+            for (int x = 0; x < width; ++x) {
+                float u = (x + 0.5f) / width + x_offset;
+                float r = sample(src, u - 0.01f * rgb_offset, src_v)[0];
+                float g = sample(src, u, src_v)[1];
+                float b = sample(src, u + 0.01f * rgb_offset, src_v)[2];
+
+                // the gpu render target clamps as well
+                float offset = static_val[x] - scanline;
+                dst_row[3 * x + 0] = std::clamp(r + offset, 0.0f, 1.0f);
+                dst_row[3 * x + 1] = std::clamp(g + offset, 0.0f, 1.0f);
+                dst_row[3 * x + 2] = std::clamp(b + offset, 0.0f, 1.0f);
+            }
+        }
+    });
+}
+
+FisheyeKernel::FisheyeKernel() = default;
+
+void FisheyeKernel::prepare(std::vector<Pin> &pins) {
+    strength = get_pin(pins, "strength")._float.val;
+}
+
+std::vector<float> FisheyeKernel::get_params() {
+    return {strength};
+}
+
+void FisheyeKernel::map(float *u, float *v, int n, int width, int height) {
+    const float center_len = std::sqrt(0.5f);
+    float power = (2.0f * PI / (2.0f * center_len)) * strength;
+    if (power == 0.0f) return;
+
+    float bind = power > 0.0f ? center_len : 0.5f;
+    float scale = power > 0.0f ? bind / std::tan(bind * power)
+                               : bind / std::atan(-power * bind * 10.0f);
+
+    for (int i = 0; i < n; ++i) {
+        float dx = u[i] - 0.5f;
+        float dy = v[i] - 0.5f;
+        float r = std::sqrt(dx * dx + dy * dy);
+        if (r == 0.0f) continue;
+
+        float k = power > 0.0f ? std::tan(r * power) : std::atan(r * -power * 10.0f);
+        k *= scale / r;
+        u[i] = 0.5f + dx * k;
+        v[i] = 0.5f + dy * k;
+    }
+}
+
+PixelizationKernel::PixelizationKernel(std::function<int()> get_proxy_scale)
+    : CpuKernel(CpuKernelKind::GATHER)
+    , get_proxy_scale(get_proxy_scale) {}
+
+CpuKernelKind PixelizationKernel::get_kind(std::vector<Pin> &pins) {
+    return get_pin(pins, "downsample")._bool ? CpuKernelKind::FRAME
+                                              : CpuKernelKind::GATHER;
+}
+
+bool PixelizationKernel::supports(CpuPrecision precision) {
+    return precision != CpuPrecision::F16;
+}
+
+void PixelizationKernel::prepare(std::vector<Pin> &pins) {
+    int full_pixel_size = get_pin(pins, "pixel_size")._int.val;
+    pixel_size = get_proxy_pixels(full_pixel_size, get_proxy_scale());
+}
+
+void PixelizationKernel::map(float *u, float *v, int n, int width, int height) {
+    if (pixel_size <= 1) return;
+
+    float step_u = (float)pixel_size / width;
+    float step_v = (float)pixel_size / height;
+    for (int i = 0; i < n; ++i) {
+        u[i] = (int)(u[i] / step_u) * step_u + step_u * 0.5f;
+        v[i] = (int)(v[i] / step_v) * step_v + step_v * 0.5f;
+    }
+}
+
+// Downsample mode: averages each pixel_size block into a single output pixel
+void PixelizationKernel::process(const cv::Mat &src, cv::Mat &dst) {
+    int ps = pixel_size;
+    int width = (src.cols + ps - 1) / ps;
+    int height = (src.rows + ps - 1) / ps;
+    dst.create(height, width, src.type());
+
+    // full blocks: integer scale INTER_AREA is a plain box average
+    int full_width = src.cols / ps;
+    int full_height = src.rows / ps;
+    if (full_width > 0 && full_height > 0) {
+        cv::Rect src_roi(0, 0, full_width * ps, full_height * ps);
+        cv::Rect dst_roi(0, 0, full_width, full_height);
+        cv::Mat dst_full = dst(dst_roi);
+        cv::resize(src(src_roi), dst_full, dst_full.size(), 0, 0, cv::INTER_AREA);
+    }
+
+    // partial blocks on the right and bottom edges
+    auto average_block = [&](int x, int y) {
+        cv::Rect block(x * ps, y * ps, ps, ps);
+        block &= cv::Rect(0, 0, src.cols, src.rows);
+        dst(cv::Rect(x, y, 1, 1)).setTo(cv::mean(src(block)));
+    };
+    for (int y = 0; y < height; ++y) {
+        for (int x = full_width; x < width; ++x) average_block(x, y);
+    }
+    for (int y = full_height; y < height; ++y) {
+        for (int x = 0; x < full_width; ++x) average_block(x, y);
+    }
+}
+
+ScaleKernel::ScaleKernel(std::function<int()> get_proxy_scale)
+    : CpuKernel(CpuKernelKind::FRAME)
+    , get_proxy_scale(get_proxy_scale) {}
+
+bool ScaleKernel::supports(CpuPrecision precision) {
+    return precision != CpuPrecision::F16;
+}
+
+void ScaleKernel::prepare(std::vector<Pin> &pins) {
+    width = get_pin(pins, "width")._int.val;
+    height = get_pin(pins, "height")._int.val;
+    scale = get_pin(pins, "scale")._float.val;
+    nearest = get_pin(pins, "nearest")._bool;
+}
+
+cv::Size ScaleKernel::get_size(int src_width, int src_height) {
+    int proxy_scale = get_proxy_scale();
+    int w = width / proxy_scale;
+    int h = height / proxy_scale;
+    if (width == 0 && height == 0) {
+        w = std::round(src_width * scale);
+        h = std::round(src_height * scale);
+    } else if (width == 0) {
+        w = std::round((float)src_width * h / std::max(src_height, 1));
+    } else if (height == 0) {
+        h = std::round((float)src_height * w / std::max(src_width, 1));
+    }
+    return cv::Size(std::max(w, 1), std::max(h, 1));
+}
+
+// OpenCV resizers are vectorized, scale.frag matches them on the gpu
+void ScaleKernel::process(const cv::Mat &src, cv::Mat &dst) {
+    cv::Size size = get_size(src.cols, src.rows);
+    int interpolation = cv::INTER_LINEAR;
+    if (nearest) {
+        interpolation = cv::INTER_NEAREST;
+    } else if (size.width <= src.cols && size.height <= src.rows) {
+        interpolation = cv::INTER_AREA;
+    }
+    cv::resize(src, dst, size, 0, 0, interpolation);
+}
+
+// -----------------------------------------------------------------------
+// backend
+CpuBackend::CpuBackend()
+    : precision(CpuPrecision::F32) {}
+
+CpuBackend::~CpuBackend() {
+    for (auto &[_, texture] : this->textures) {
+        UnloadTexture(texture);
+    }
+    for (auto &[_, texture] : this->gpu_inputs) {
+        UnloadTexture(texture);
+    }
+}
+
+void CpuBackend::compile(Graph &graph) {
+    this->steps.clear();
+
+    // step index of each run which can still be extended, by its last node id
+    std::unordered_map<int, int> open_runs;
+
+    for (int id : graph.order) {
+        auto node = graph.nodes[id];
+        auto kernel = node->context->get_cpu_kernel();
+        auto input = graph.get_input_node(node);
+
+        auto kind = kernel ? kernel->get_kind(node->pins) : CpuKernelKind::FRAME;
+        bool is_fusible = kind == CpuKernelKind::POINTWISE
+                          || kind == CpuKernelKind::GATHER;
+        // the previews split the run while they're due, see update()
+        bool is_materialized = graph.get_n_consumers(node) != 1;
+
+        // conversions are inserted only before the kernels which need the
+        // float range, the fused runs are specialized for every precision
+        auto precision = this->precision;
+        if (!is_fusible && kernel && !kernel->supports(precision)) {
+            precision = CpuPrecision::F32;
+        }
+
+        int step_idx;
+        if (is_fusible && input && open_runs.count(input->id)) {
+            step_idx = open_runs[input->id];
+            open_runs.erase(input->id);
+            this->steps[step_idx].nodes.push_back(node);
+        } else {
+            step_idx = this->steps.size();
+            this->steps.push_back({{node}, kind, precision});
+        }
+
+        if (is_fusible && !is_materialized) open_runs[id] = step_idx;
+    }
+
+    // release the resources of the deleted nodes
+    for (auto *map : {&this->textures, &this->gpu_inputs}) {
+        for (auto it = map->begin(); it != map->end();) {
+            if (graph.nodes.count(it->first)) {
+                ++it;
+                continue;
+            }
+            UnloadTexture(it->second);
+            it = map->erase(it);
+        }
+    }
+    for (auto it = this->frames.begin(); it != this->frames.end();) {
+        if (graph.nodes.count(it->first)) {
+            ++it;
+        } else {
+            it = this->frames.erase(it);
+        }
+    }
+}
+
+void CpuBackend::update(Graph &graph) {
+    float time = graph.get_time();
+    for (auto &step : this->steps) {
+        auto first = step.nodes.front();
+        auto last = step.nodes.back();
+
+        for (auto &node : step.nodes) {
+            graph.transfer_links(node);
+            node->pins.back()._texture.id = 0;
+            auto kernel = node->context->get_cpu_kernel();
+            if (!kernel) continue;
+            kernel->frame_idx = graph.frame_idx;
+            kernel->time = time;
+        }
+
+        cv::Mat src;
+        auto input = graph.get_input_node(first);
+        if (input && this->frames.count(input->id)) src = this->frames[input->id];
+        cv::Mat &dst = this->frames[last->id];
+
+        TraceScope scope("node", last->name.c_str());
+        graph.profiler.begin(last->id);
+        bool is_split = std::any_of(
+            step.nodes.begin(), step.nodes.end() - 1, [](auto &node) {
+                return node->is_preview_due;
+            }
+        );
+        if (is_split) {
+            run_split(step, src, dst);
+        } else {
+            run(step, src, dst);
+            upload_preview(last, dst);
+        }
+        graph.profiler.end();
+    }
+}
+
+void CpuBackend::run_split(CpuStep &step, const cv::Mat &src, cv::Mat &dst) {
+    cv::Mat input = src;
+    for (auto &node : step.nodes) {
+        // the outputs of the fused nodes aren't kept
+        cv::Mat output;
+        cv::Mat &frame = node == step.nodes.back() ? dst : output;
+        CpuStep single = {{node}, step.kind, step.precision};
+        run(single, input, frame);
+        upload_preview(node, frame);
+        input = frame;
+    }
+}
+
+void CpuBackend::upload_preview(std::shared_ptr<Node> node, const cv::Mat &frame) {
+    if (!node->is_preview_due || frame.empty()) return;
+    Texture &texture = this->textures[node->id];
+    upload_texture(texture, frame);
+    node->pins.back()._texture = texture;
+}
+
+cv::Mat CpuBackend::get_frame(int node_id) {
+    auto it = this->frames.find(node_id);
+    return it == this->frames.end() ? cv::Mat() : it->second;
+}
+
+void CpuBackend::run(CpuStep &step, const cv::Mat &src, cv::Mat &dst) {
+    auto first = step.nodes.front();
+    auto kernel = first->context->get_cpu_kernel();
+
+    if (!kernel) {
+        run_on_gpu(first, src, dst);
+        return;
+    }
+
+    if (step.kind == CpuKernelKind::SOURCE) {
+        kernel->prepare(first->pins);
+        kernel->process(src, dst);
+        return;
+    }
+
+    if (src.empty()) {
+        dst.release();
+        return;
+    }
+
+    const cv::Mat *input = &src;
+    int depth = get_depth(step.precision);
+    if (src.depth() != depth) {
+        convert_frame(src, step.converted_input, depth);
+        input = &step.converted_input;
+    }
+
+    if (step.kind == CpuKernelKind::FRAME) {
+        kernel->prepare(first->pins);
+        kernel->process(*input, dst);
+    } else {
+        run_fused(step, *input, dst);
+    }
+}
+
+// The rows are stored as T, the tiles are always float: kernels have a single
+// float implementation, and only the loads and stores are specialized. Each
+// tile converts with the vectorized cv::Mat::convertTo while it's in L1.
+template <typename T>
+static void run_fused_tiles(
+    const std::vector<CpuKernel *> &gathers,
+    const std::vector<CpuKernel *> &pointwises,
+    const cv::Mat &src,
+    cv::Mat &dst
+) {
+    static const int TILE_SIZE = 256;
+
+    int width = src.cols;
+    int height = src.rows;
+    int type = src.type();
+    double unit = get_unit(src.depth());
+    float inv_unit = 1.0 / unit;
+    dst.create(src.size(), type);
+
+    // With nearest sampling a gather commutes with any pointwise op, so each
+    // tile is fetched through all the gathers at once and then goes through
+    // the pointwise ops while it's still in L1.
+    parallel_for(height, [&](int y0, int y1) {
+        float u[TILE_SIZE], v[TILE_SIZE], rgb[3 * TILE_SIZE];
+
+        for (int y = y0; y < y1; ++y) {
+            T *dst_row = dst.ptr<T>(y);
+
+            for (int x0 = 0; x0 < width; x0 += TILE_SIZE) {
+                int n = std::min(TILE_SIZE, width - x0);
+                cv::Mat tile(1, n, CV_32FC3, rgb);
+
+                if (gathers.empty()) {
+                    cv::Mat row(1, n, type, (void *)(src.ptr<T>(y) + 3 * x0));
+                    row.convertTo(tile, CV_32F, inv_unit);
+                } else {
+                    for (int i = 0; i < n; ++i) {
+                        u[i] = (x0 + i + 0.5f) / width;
+                        v[i] = (y + 0.5f) / height;
+                    }
+
+                    for (int g = gathers.size() - 1; g >= 0; --g) {
+                        // each gather reads the previous one's output at
+                        // its texel centers
+                        if (g != (int)gathers.size() - 1) {
+                            for (int i = 0; i < n; ++i) {
+                                u[i] = (get_texel(u[i], width) + 0.5f) / width;
+                                v[i] = (get_texel(v[i], height) + 0.5f) / height;
+                            }
+                        }
+                        gathers[g]->map(u, v, n, width, height);
+                    }
+
+                    for (int i = 0; i < n; ++i) {
+                        const T *texel = sample<T>(src, u[i], v[i]);
+                        for (int c = 0; c < 3; ++c) {
+                            rgb[3 * i + c] = static_cast<float>(texel[c]) * inv_unit;
+                        }
+                    }
+                }
+
+                for (auto kernel : pointwises) {
+                    kernel->apply(rgb, n);
+                }
+
+                cv::Mat row(1, n, type, dst_row + 3 * x0);
+                tile.convertTo(row, src.depth(), unit);
+            }
+        }
+    });
+}
+
+void CpuBackend::run_fused(CpuStep &step, const cv::Mat &src, cv::Mat &dst) {
+    std::vector<CpuKernel *> gathers;
+    std::vector<CpuKernel *> pointwises;
+    for (auto &node : step.nodes) {
+        auto kernel = node->context->get_cpu_kernel();
+        kernel->prepare(node->pins);
+        if (kernel->kind == CpuKernelKind::GATHER) {
+            gathers.push_back(kernel);
+        } else {
+            pointwises.push_back(kernel);
+        }
+    }
+
+    switch (src.depth()) {
+        case CV_8U: run_fused_tiles<uint8_t>(gathers, pointwises, src, dst); break;
+        case CV_16U: run_fused_tiles<uint16_t>(gathers, pointwises, src, dst); break;
+        case CV_16F: run_fused_tiles<cv::float16_t>(gathers, pointwises, src, dst); break;
+        default: run_fused_tiles<float>(gathers, pointwises, src, dst); break;
+    }
+}
+
+void CpuBackend::run_on_gpu(
+    std::shared_ptr<Node> node, const cv::Mat &src, cv::Mat &dst
+) {
+    Pin &input = node->pins[0];
+    if (input.kind == PinKind::INPUT) {
+        if (src.empty()) {
+            dst.release();
+            return;
+        }
+        Texture &texture = this->gpu_inputs[node->id];
+        upload_texture(texture, src);
+        input._texture = texture;
+    }
+
+    node->context->update(node);
+
+    Texture output = node->pins.back()._texture;
+    if (!IsTextureReady(output)) {
+        dst.release();
+        return;
+    }
+
+    // forwarded and uploaded textures are rgb, render targets rgba, any
+    // other format is converted to rgba by the read
+    int format = output.format;
+    if (format != RL_PIXELFORMAT_UNCOMPRESSED_R8G8B8) {
+        format = RL_PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+    }
+    auto pixels = (unsigned char *)rlReadTexturePixels(
+        output.id, output.width, output.height, format
+    );
+    if (format == RL_PIXELFORMAT_UNCOMPRESSED_R8G8B8) {
+        cv::Mat(output.height, output.width, CV_8UC3, pixels).copyTo(dst);
+    } else {
+        cv::Mat rgba(output.height, output.width, CV_8UC4, pixels);
+        cv::cvtColor(rgba, dst, cv::COLOR_RGBA2RGB);
+    }
+    MemFree(pixels);
+}
@@ -0,0 +1,316 @@
+#pragma once
+#include "graph.hpp"
+#include "opencv2/core/mat.hpp"
+#include "raylib/raylib.h"
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Frames on the cpu backend are 3 channel mats: interleaved RGB in [0, 1]
+// (scaled to 255 or 65535 for the integer depths), row 0 is the first texture
+// row (uv.y == 0), same as on the gpu.
+
+// splits [0, n) into a stripe per thread, cv::setNumThreads() limits all
+// the calls
+void parallel_for(int n, const std::function<void(int, int)> &fn);
+
+// limits parallel_for calls of the calling thread, 0 means the opencv
+// threads
+void set_max_threads(int max_threads);
+
+// storage of the frames between the steps, kernels always compute in float
+enum class CpuPrecision {
+    F32,
+    F16,
+    U16,
+    U8,
+};
+
+int get_depth(CpuPrecision precision);
+
+// mean over [x - r, x + r] x [y - r, y + r] without the taps outside of the
+// frame, CV_32FC3
+void box_blur(const cv::Mat &src, cv::Mat &dst, int r);
+// max over the same square, CV_32F
+void max_filter(const cv::Mat &src, cv::Mat &dst, int r);
+
+// converts to the depth keeping the values in [0, 1] units
+void convert_frame(const cv::Mat &src, cv::Mat &dst, int depth);
+
+enum class CpuKernelKind {
+    // produces a frame without an input (video source)
+    SOURCE,
+    // out(uv) = f(in(uv)), can be fused
+    POINTWISE,
+    // out(uv) = in(g(uv)) with nearest sampling, can be fused
+    GATHER,
+    // anything else, always materializes its output
+    FRAME,
+};
+
+class CpuKernel {
+public:
+    CpuKernelKind kind;
+    // Graph::frame_idx and Graph::get_time() of the update, set by the
+    // backend before prepare()
+    int frame_idx;
+    float time;
+
+    CpuKernel(CpuKernelKind kind);
+    virtual ~CpuKernel() {}
+
+    // kind might depend on the pins, the graph is recompiled when they change
+    virtual CpuKernelKind get_kind(std::vector<Pin> &pins);
+
+    // whether process() takes frames of this precision, otherwise its input
+    // is converted to F32, fused kernels support any precision
+    virtual bool supports(CpuPrecision precision);
+
+    // called once per frame before any of the methods below
+    virtual void prepare(std::vector<Pin> &pins) {}
+
+    // POINTWISE: transforms n RGB pixels in place
+    virtual void apply(float *rgb, int n) {}
+
+    // GATHER: maps n output uv coordinates to the input uv coordinates,
+    // width and height are the input frame size
+    virtual void map(float *u, float *v, int n, int width, int height) {}
+
+    // SOURCE and FRAME, dst might have any size
+    virtual void process(const cv::Mat &src, cv::Mat &dst) {}
+};
+
+// -----------------------------------------------------------------------
+// remap
+// Output pixel -> input coordinate table of a geometric warp. It's rebuilt
+// only when the warp params or the frame size change, so each frame is
+// just a single bilinear gather.
+class RemapTable {
+private:
+    std::vector<float> params;
+    cv::Mat map_xy;
+    cv::Mat map_weights;
+
+public:
+    // input uv by output pixel (third channel is unused), for gpu upload
+    cv::Mat uv;
+    // incremented on each rebuild
+    int version;
+
+    RemapTable();
+
+    bool update(
+        const std::vector<float> &params,
+        int width,
+        int height,
+        const std::function<void(float *, float *, int)> &map
+    );
+    void apply(const cv::Mat &src, cv::Mat &dst);
+};
+
+// Base of geometric warp kernels: with the cached_remap pin on, map() is
+// baked into a RemapTable and the warp runs as a FRAME kernel
+class WarpKernel : public CpuKernel {
+public:
+    RemapTable table;
+
+    WarpKernel();
+    CpuKernelKind get_kind(std::vector<Pin> &pins) override;
+    bool supports(CpuPrecision precision) override;
+
+    // everything map() depends on besides the frame size
+    virtual std::vector<float> get_params() = 0;
+
+    void update_table(int width, int height);
+    void process(const cv::Mat &src, cv::Mat &dst) override;
+};
+
+// -----------------------------------------------------------------------
+// kernels
+// read() gets the frame and the stamp of the output pin
+class SourceKernel : public CpuKernel {
+private:
+    std::function<void(cv::Mat &, FrameStamp &)> read;
+    std::vector<Pin> *pins;
+
+public:
+    SourceKernel(std::function<void(cv::Mat &, FrameStamp &)> read);
+    bool supports(CpuPrecision precision) override;
+    void prepare(std::vector<Pin> &pins) override;
+    void process(const cv::Mat &src, cv::Mat &dst) override;
+};
+
+// passes the frame through and hands it to write() with the node pins
+class SinkKernel : public CpuKernel {
+private:
+    std::function<void(std::vector<Pin> &, const cv::Mat &)> write;
+    std::vector<Pin> *pins;
+
+public:
+    SinkKernel(std::function<void(std::vector<Pin> &, const cv::Mat &)> write);
+    bool supports(CpuPrecision precision) override;
+    void prepare(std::vector<Pin> &pins) override;
+    void process(const cv::Mat &src, cv::Mat &dst) override;
+};
+
+class ColorCorrectionKernel : public CpuKernel {
+private:
+    Vector3 white_balance;
+    float exposure;
+    float temperature;
+    float contrast;
+    float brightness;
+    float saturation;
+    float gamma;
+
+public:
+    ColorCorrectionKernel();
+    void prepare(std::vector<Pin> &pins) override;
+    void apply(float *rgb, int n) override;
+};
+
+// radius is in full resolution pixels, divided by the proxy scale
+class ColorQuantizationKernel : public CpuKernel {
+private:
+    std::function<int()> get_proxy_scale;
+    int n_levels;
+    int n_samples;
+    int radius;
+    int noise_frame;
+    bool fast_blur;
+
+public:
+    ColorQuantizationKernel(std::function<int()> get_proxy_scale);
+    void prepare(std::vector<Pin> &pins) override;
+    void process(const cv::Mat &src, cv::Mat &dst) override;
+};
+
+// radius is in full resolution pixels, divided by the proxy scale
+class ColorOutlineKernel : public CpuKernel {
+private:
+    std::function<int()> get_proxy_scale;
+    Vector3 color;
+    float threshold;
+    int n_samples;
+    int radius;
+    int noise_frame;
+    bool fast_outline;
+
+    void process_fast(const cv::Mat &src, cv::Mat &dst);
+
+public:
+    ColorOutlineKernel(std::function<int()> get_proxy_scale);
+    void prepare(std::vector<Pin> &pins) override;
+    void process(const cv::Mat &src, cv::Mat &dst) override;
+};
+
+class OldTvKernel : public CpuKernel {
+private:
+    float vert_jerk;
+    float vert_movement;
+    float bottom_static;
+    float scanlines;
+    float rgb_offset;
+    float horz_fuzz;
+
+public:
+    OldTvKernel();
+    void prepare(std::vector<Pin> &pins) override;
+    void process(const cv::Mat &src, cv::Mat &dst) override;
+};
+
+class FisheyeKernel : public WarpKernel {
+private:
+    float strength;
+
+public:
+    FisheyeKernel();
+    void prepare(std::vector<Pin> &pins) override;
+    void map(float *u, float *v, int n, int width, int height) override;
+    std::vector<float> get_params() override;
+};
+
+// pixel_size is in full resolution pixels, divided by the proxy scale
+class PixelizationKernel : public CpuKernel {
+private:
+    std::function<int()> get_proxy_scale;
+    int pixel_size;
+
+public:
+    PixelizationKernel(std::function<int()> get_proxy_scale);
+    CpuKernelKind get_kind(std::vector<Pin> &pins) override;
+    bool supports(CpuPrecision precision) override;
+    void prepare(std::vector<Pin> &pins) override;
+    void map(float *u, float *v, int n, int width, int height) override;
+    void process(const cv::Mat &src, cv::Mat &dst) override;
+};
+
+// Resamples to the width x height pins in full resolution pixels (divided by
+// the proxy scale), one of them might be 0 to keep the aspect ratio, both 0
+// mean the input size times the scale pin
+class ScaleKernel : public CpuKernel {
+private:
+    std::function<int()> get_proxy_scale;
+    int width;
+    int height;
+    float scale;
+    bool nearest;
+
+public:
+    ScaleKernel(std::function<int()> get_proxy_scale);
+    bool supports(CpuPrecision precision) override;
+    void prepare(std::vector<Pin> &pins) override;
+    void process(const cv::Mat &src, cv::Mat &dst) override;
+
+    // output size for the input size
+    cv::Size get_size(int src_width, int src_height);
+};
+
+// -----------------------------------------------------------------------
+// backend
+class CpuStep {
+public:
+    // a single node, or a fused run of POINTWISE and GATHER nodes where
+    // every node except the last one feeds only the next node of the run
+    std::vector<std::shared_ptr<Node>> nodes;
+    CpuKernelKind kind;
+
+    // the input is converted to this precision if it's stored differently
+    CpuPrecision precision;
+    cv::Mat converted_input;
+};
+
+class CpuBackend {
+private:
+    std::vector<CpuStep> steps;
+
+    // materialized outputs and the preview textures, by node id
+    std::unordered_map<int, cv::Mat> frames;
+    std::unordered_map<int, Texture> textures;
+
+    // input textures of the nodes which fall back to the gpu, by node id
+    std::unordered_map<int, Texture> gpu_inputs;
+
+    void run_fused(CpuStep &step, const cv::Mat &src, cv::Mat &dst);
+    void run_on_gpu(std::shared_ptr<Node> node, const cv::Mat &src, cv::Mat &dst);
+    // runs the fused nodes one by one, for a due preview inside the run
+    void run_split(CpuStep &step, const cv::Mat &src, cv::Mat &dst);
+    void upload_preview(std::shared_ptr<Node> node, const cv::Mat &frame);
+
+public:
+    // the graph must be recompiled when it changes
+    CpuPrecision precision;
+
+    CpuBackend();
+    ~CpuBackend();
+
+    void compile(Graph &graph);
+    void update(Graph &graph);
+
+    // runs a single step without transferring the links
+    void run(CpuStep &step, const cv::Mat &src, cv::Mat &dst);
+
+    // materialized output of the node, empty if there's none
+    cv::Mat get_frame(int node_id);
+};
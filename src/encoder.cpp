@@ -0,0 +1,116 @@
+#include "encoder.hpp"
+
+#include "opencv2/imgproc.hpp"
+#include "raylib/raylib.h"
+
+VideoEncoder::VideoEncoder(int capacity)
+    : capacity(capacity)
+    , fps(30.0)
+    , is_done(true)
+    , n_encoded(0)
+    , n_dropped(0) {}
+
+VideoEncoder::~VideoEncoder() {
+    close();
+}
+
+void VideoEncoder::open(const std::string &file_name, double fps) {
+    close();
+
+    this->file_name = file_name;
+    this->fps = fps;
+    this->size = cv::Size();
+    this->is_done = false;
+    this->n_encoded = 0;
+    this->n_dropped = 0;
+    this->thread = std::thread(&VideoEncoder::encode_frames, this);
+}
+
+void VideoEncoder::close() {
+    if (!this->thread.joinable()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->is_done = true;
+    }
+    this->condition.notify_all();
+    this->thread.join();
+
+    this->writer.release();
+    TraceLog(
+        LOG_INFO,
+        "ENCODER: %s: %d frames, %d dropped",
+        this->file_name.c_str(),
+        this->n_encoded.load(),
+        this->n_dropped.load()
+    );
+}
+
+bool VideoEncoder::is_open() {
+    return this->thread.joinable();
+}
+
+bool VideoEncoder::push(cv::Mat frame, EncoderPolicy policy) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    if (this->is_done) return false;
+
+    if (this->queue.size() >= this->capacity) {
+        if (policy == EncoderPolicy::DROP) {
+            this->n_dropped += 1;
+            return false;
+        }
+        this->condition.wait(lock, [this] {
+            return this->queue.size() < this->capacity || this->is_done;
+        });
+        if (this->is_done) return false;
+    }
+
+    this->queue.push_back(std::move(frame));
+    this->condition.notify_all();
+    return true;
+}
+
+void VideoEncoder::encode_frames() {
+    while (true) {
+        cv::Mat frame;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->condition.wait(lock, [this] {
+                return this->is_done || !this->queue.empty();
+            });
+            if (this->queue.empty()) return;
+            frame = std::move(this->queue.front());
+            this->queue.pop_front();
+        }
+        this->condition.notify_all();
+        write(frame);
+    }
+}
+
+void VideoEncoder::write(const cv::Mat &frame) {
+    if (this->size.empty()) {
+        this->size = frame.size();
+        int fourcc = cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+        this->writer.open(this->file_name, fourcc, this->fps, this->size);
+        if (!this->writer.isOpened()) {
+            TraceLog(LOG_WARNING, "ENCODER: Failed to open %s", this->file_name.c_str());
+        }
+    }
+    if (!this->writer.isOpened()) {
+        this->n_dropped += 1;
+        return;
+    }
+
+    // the size changes with the proxy scale, the file keeps the first one
+    cv::Mat bgr;
+    if (frame.size() != this->size) {
+        cv::Mat resized;
+        cv::resize(frame, resized, this->size, 0.0, 0.0, cv::INTER_AREA);
+        cv::cvtColor(resized, bgr, cv::COLOR_RGB2BGR);
+    } else {
+        cv::cvtColor(frame, bgr, cv::COLOR_RGB2BGR);
+    }
+
+    this->writer.write(bgr);
+    this->n_encoded += 1;
+}
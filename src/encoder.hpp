@@ -0,0 +1,57 @@
+#pragma once
+#include "opencv2/core/mat.hpp"
+#include "opencv2/videoio.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// what push() does when the queue is full
+enum class EncoderPolicy {
+    // drops the frame, the caller never waits for the encoder
+    DROP,
+    // waits for a free slot, no frame is lost
+    BLOCK,
+};
+
+// Encodes RGB u8 frames to an MJPG video on its own thread. The frames go
+// through a queue of at most capacity frames, which bounds the memory while
+// the encoder falls behind.
+class VideoEncoder {
+private:
+    size_t capacity;
+    std::string file_name;
+    double fps;
+
+    cv::VideoWriter writer;
+    // the writer is opened on the first frame, all frames get its size
+    cv::Size size;
+
+    std::deque<cv::Mat> queue;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::thread thread;
+    bool is_done;
+
+    void encode_frames();
+    void write(const cv::Mat &frame);
+
+public:
+    // counters of the current file
+    std::atomic<int> n_encoded;
+    std::atomic<int> n_dropped;
+
+    VideoEncoder(int capacity);
+    ~VideoEncoder();
+
+    // starts a new file, finishing the current one
+    void open(const std::string &file_name, double fps);
+    // encodes the queued frames and finishes the file
+    void close();
+    bool is_open();
+
+    // the frame must not be modified after the call, false if it's dropped
+    bool push(cv::Mat frame, EncoderPolicy policy);
+};
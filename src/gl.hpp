@@ -0,0 +1,123 @@
+#pragma once
+#include "GL/glcorearb.h"
+
+// The gl functions rlgl doesn't wrap. They are the pointers of the glad
+// loader built into raylib, filled by rlLoadExtensions() for both the window
+// and the offscreen context, so the names are mapped the same way glad does.
+extern "C" {
+extern PFNGLGENBUFFERSPROC glad_glGenBuffers;
+extern PFNGLDELETEBUFFERSPROC glad_glDeleteBuffers;
+extern PFNGLBINDBUFFERPROC glad_glBindBuffer;
+extern PFNGLBUFFERDATAPROC glad_glBufferData;
+extern PFNGLBUFFERSUBDATAPROC glad_glBufferSubData;
+extern PFNGLBINDBUFFERBASEPROC glad_glBindBufferBase;
+extern PFNGLMAPBUFFERRANGEPROC glad_glMapBufferRange;
+extern PFNGLUNMAPBUFFERPROC glad_glUnmapBuffer;
+extern PFNGLGENFRAMEBUFFERSPROC glad_glGenFramebuffers;
+extern PFNGLDELETEFRAMEBUFFERSPROC glad_glDeleteFramebuffers;
+extern PFNGLBINDFRAMEBUFFERPROC glad_glBindFramebuffer;
+extern PFNGLFRAMEBUFFERTEXTURE2DPROC glad_glFramebufferTexture2D;
+extern PFNGLREADBUFFERPROC glad_glReadBuffer;
+extern PFNGLREADPIXELSPROC glad_glReadPixels;
+extern PFNGLFENCESYNCPROC glad_glFenceSync;
+extern PFNGLCLIENTWAITSYNCPROC glad_glClientWaitSync;
+extern PFNGLDELETESYNCPROC glad_glDeleteSync;
+extern PFNGLGETPROGRAMIVPROC glad_glGetProgramiv;
+extern PFNGLGETACTIVEUNIFORMPROC glad_glGetActiveUniform;
+extern PFNGLGETUNIFORMLOCATIONPROC glad_glGetUniformLocation;
+extern PFNGLGETUNIFORMBLOCKINDEXPROC glad_glGetUniformBlockIndex;
+extern PFNGLUNIFORMBLOCKBINDINGPROC glad_glUniformBlockBinding;
+extern PFNGLGETACTIVEUNIFORMBLOCKIVPROC glad_glGetActiveUniformBlockiv;
+extern PFNGLGETUNIFORMINDICESPROC glad_glGetUniformIndices;
+extern PFNGLGETACTIVEUNIFORMSIVPROC glad_glGetActiveUniformsiv;
+extern PFNGLGETSTRINGPROC glad_glGetString;
+extern PFNGLCREATEPROGRAMPROC glad_glCreateProgram;
+extern PFNGLDELETEPROGRAMPROC glad_glDeleteProgram;
+extern PFNGLGETPROGRAMBINARYPROC glad_glGetProgramBinary;
+extern PFNGLPROGRAMBINARYPROC glad_glProgramBinary;
+extern PFNGLPROGRAMPARAMETERIPROC glad_glProgramParameteri;
+extern PFNGLGETINTEGERVPROC glad_glGetIntegerv;
+extern PFNGLGETSTRINGIPROC glad_glGetStringi;
+extern PFNGLCREATESHADERPROC glad_glCreateShader;
+extern PFNGLSHADERSOURCEPROC glad_glShaderSource;
+extern PFNGLCOMPILESHADERPROC glad_glCompileShader;
+extern PFNGLGETSHADERIVPROC glad_glGetShaderiv;
+extern PFNGLGETSHADERINFOLOGPROC glad_glGetShaderInfoLog;
+extern PFNGLGETPROGRAMINFOLOGPROC glad_glGetProgramInfoLog;
+extern PFNGLATTACHSHADERPROC glad_glAttachShader;
+extern PFNGLDETACHSHADERPROC glad_glDetachShader;
+extern PFNGLDELETESHADERPROC glad_glDeleteShader;
+extern PFNGLBINDATTRIBLOCATIONPROC glad_glBindAttribLocation;
+extern PFNGLLINKPROGRAMPROC glad_glLinkProgram;
+extern PFNGLUSEPROGRAMPROC glad_glUseProgram;
+extern PFNGLUNIFORM1IPROC glad_glUniform1i;
+extern PFNGLACTIVETEXTUREPROC glad_glActiveTexture;
+extern PFNGLBINDTEXTUREPROC glad_glBindTexture;
+extern PFNGLBINDIMAGETEXTUREPROC glad_glBindImageTexture;
+extern PFNGLDISPATCHCOMPUTEPROC glad_glDispatchCompute;
+extern PFNGLMEMORYBARRIERPROC glad_glMemoryBarrier;
+extern PFNGLFINISHPROC glad_glFinish;
+extern PFNGLGENQUERIESPROC glad_glGenQueries;
+extern PFNGLBEGINQUERYPROC glad_glBeginQuery;
+extern PFNGLENDQUERYPROC glad_glEndQuery;
+extern PFNGLGETQUERYOBJECTIVPROC glad_glGetQueryObjectiv;
+extern PFNGLGETQUERYOBJECTUI64VPROC glad_glGetQueryObjectui64v;
+}
+
+#define glGenBuffers glad_glGenBuffers
+#define glDeleteBuffers glad_glDeleteBuffers
+#define glBindBuffer glad_glBindBuffer
+#define glBufferData glad_glBufferData
+#define glBufferSubData glad_glBufferSubData
+#define glBindBufferBase glad_glBindBufferBase
+#define glMapBufferRange glad_glMapBufferRange
+#define glUnmapBuffer glad_glUnmapBuffer
+#define glGenFramebuffers glad_glGenFramebuffers
+#define glDeleteFramebuffers glad_glDeleteFramebuffers
+#define glBindFramebuffer glad_glBindFramebuffer
+#define glFramebufferTexture2D glad_glFramebufferTexture2D
+#define glReadBuffer glad_glReadBuffer
+#define glReadPixels glad_glReadPixels
+#define glFenceSync glad_glFenceSync
+#define glClientWaitSync glad_glClientWaitSync
+#define glDeleteSync glad_glDeleteSync
+#define glGetProgramiv glad_glGetProgramiv
+#define glGetActiveUniform glad_glGetActiveUniform
+#define glGetUniformLocation glad_glGetUniformLocation
+#define glGetUniformBlockIndex glad_glGetUniformBlockIndex
+#define glUniformBlockBinding glad_glUniformBlockBinding
+#define glGetActiveUniformBlockiv glad_glGetActiveUniformBlockiv
+#define glGetUniformIndices glad_glGetUniformIndices
+#define glGetActiveUniformsiv glad_glGetActiveUniformsiv
+#define glGetString glad_glGetString
+#define glCreateProgram glad_glCreateProgram
+#define glDeleteProgram glad_glDeleteProgram
+#define glGetProgramBinary glad_glGetProgramBinary
+#define glProgramBinary glad_glProgramBinary
+#define glProgramParameteri glad_glProgramParameteri
+#define glGetIntegerv glad_glGetIntegerv
+#define glGetStringi glad_glGetStringi
+#define glCreateShader glad_glCreateShader
+#define glShaderSource glad_glShaderSource
+#define glCompileShader glad_glCompileShader
+#define glGetShaderiv glad_glGetShaderiv
+#define glGetShaderInfoLog glad_glGetShaderInfoLog
+#define glGetProgramInfoLog glad_glGetProgramInfoLog
+#define glAttachShader glad_glAttachShader
+#define glDetachShader glad_glDetachShader
+#define glDeleteShader glad_glDeleteShader
+#define glBindAttribLocation glad_glBindAttribLocation
+#define glLinkProgram glad_glLinkProgram
+#define glUseProgram glad_glUseProgram
+#define glUniform1i glad_glUniform1i
+#define glActiveTexture glad_glActiveTexture
+#define glBindTexture glad_glBindTexture
+#define glBindImageTexture glad_glBindImageTexture
+#define glDispatchCompute glad_glDispatchCompute
+#define glMemoryBarrier glad_glMemoryBarrier
+#define glFinish glad_glFinish
+#define glGenQueries glad_glGenQueries
+#define glBeginQuery glad_glBeginQuery
+#define glEndQuery glad_glEndQuery
+#define glGetQueryObjectiv glad_glGetQueryObjectiv
+#define glGetQueryObjectui64v glad_glGetQueryObjectui64v
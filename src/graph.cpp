@@ -1,48 +1,153 @@
 #include "graph.hpp"
 
+#include "cpu.hpp"
+#include "encoder.hpp"
+#include "gl.hpp"
+#include "imgui/crude_json.h"
+#include "noise.hpp"
 #include "opencv2/core/mat.hpp"
 #include "opencv2/imgproc.hpp"
 #include "opencv2/videoio.hpp"
 #include "raylib/raylib.h"
 #include "raylib/rlgl.h"
+#include "readback.hpp"
+#include "shader_cache.hpp"
+#include "trace.hpp"
+#include "uniforms.hpp"
 #include <algorithm>
 #include <atomic>
+#include <cmath>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <filesystem>
 #include <fstream>
 #include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <regex>
+#include <set>
+#include <sstream>
 #include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <thread>
+#include <tuple>
+#include <unistd.h>
 #include <unordered_map>
 #include <vector>
 
 // -----------------------------------------------------------------------
 // shader utils
+// sources by file name, the files are read once, the shader reload replaces
+// the sources once they compile
+static std::unordered_map<std::string, std::string> SHADER_SRCS;
+
+// vs and fs file names of the loaded shaders
+static std::set<std::pair<std::string, std::string>> LOADED_SHADERS;
+
+// fs and cs file names and halos of the loaded compute shaders
+static std::set<std::tuple<std::string, std::string, int>> LOADED_COMPUTE_SHADERS;
+
+// incremented when the reloaded shaders are swapped in
+static int SHADER_GENERATION = 0;
+
+static std::string read_file(const std::string &file_name) {
+    std::ifstream file(file_name);
+    std::stringstream stream;
+    stream << file.rdbuf();
+    return stream.str();
+}
+
+static std::string read_shader_file(const std::string &file_name) {
+    auto it = SHADER_SRCS.find(file_name);
+    if (it != SHADER_SRCS.end()) return it->second;
+    return SHADER_SRCS[file_name] = read_file("shaders/" + file_name);
+}
+
+// prepends the version and common.glsl
+static std::string get_full_shader_src(
+    const std::string &shader_src, const std::string &common_src
+) {
+    // the highest version of a 3.3 core context, so the shaders also compile
+    // on drivers without 4.6, e.g. llvmpipe in the offscreen context
+    const std::string version_src = "#version 330 core";
+    return version_src + "\n" + common_src + "\n" + shader_src;
+}
+
+static std::string get_full_shader_src(const std::string &shader_src) {
+    return get_full_shader_src(shader_src, read_shader_file("common.glsl"));
+}
+
 std::string load_shader_src(const std::string &file_name) {
-    const std::string version_src = "#version 460 core";
-    std::ifstream common_file("shaders/common.glsl");
-    std::ifstream shader_file("shaders/" + file_name);
+    return get_full_shader_src(read_shader_file(file_name));
+}
+
+// the fragment shader without main() and the inputs and outputs, its
+// functions and the Params block and members get the prefix, so that the
+// shaders of the same node don't clash in a fused shader
+static std::string get_stage_src(
+    const std::string &fs_src, const std::string &prefix = ""
+) {
+    static const std::regex function_re("^\\w+\\s+(\\w+)\\s*\\(");
+    static const std::regex member_re("^\\s*\\w+\\s+(\\w+)\\s*;");
+
+    std::istringstream stream(fs_src);
+    std::vector<std::string> names = {"Params"};
+    std::string src;
+    std::string line;
+    bool is_params = false;
+    while (std::getline(stream, line)) {
+        if (line.rfind("void main", 0) == 0) break;
+        if (line == "in vec2 vs_uv;" || line == "uniform sampler2D frame;"
+            || line == "out vec4 fs_color;") {
+            continue;
+        }
+
+        std::smatch match;
+        if (line.find("uniform Params") != std::string::npos) {
+            is_params = true;
+        } else if (is_params && line.rfind("};", 0) == 0) {
+            is_params = false;
+        } else if (is_params && std::regex_search(line, match, member_re)) {
+            names.push_back(match[1]);
+        } else if (std::regex_search(line, match, function_re)) {
+            names.push_back(match[1]);
+        }
+        src += line + "\n";
+    }
 
-    std::stringstream common_stream, shader_stream;
-    common_stream << common_file.rdbuf();
-    shader_stream << shader_file.rdbuf();
+    if (prefix.empty()) return src;
+    for (auto &name : names) {
+        src = std::regex_replace(src, std::regex("\\b" + name + "\\b"), prefix + name);
+    }
+    return src;
+}
 
-    std::string common_src = common_stream.str();
-    std::string shader_src = shader_stream.str();
+static bool IS_GL_CLOSED = false;
 
-    std::string full_src = version_src + "\n" + common_src + "\n" + shader_src;
+bool is_gl_ready() {
+    // the default shader is loaded by rlglInit(), rlglClose() keeps its id
+    return !IS_GL_CLOSED && rlGetShaderIdDefault() != 0;
+}
 
-    return full_src;
+void set_gl_closed() {
+    IS_GL_CLOSED = true;
 }
 
 Shader load_shader(const std::string &vs_file_name, const std::string &fs_file_name) {
-    std::string vs, fs;
-
-    vs = load_shader_src(vs_file_name);
-    fs = load_shader_src(fs_file_name);
-    Shader shader = LoadShaderFromMemory(vs.c_str(), fs.c_str());
-    return shader;
+    // nodes are still created without a context, their cpu kernels don't
+    // need the shaders
+    if (!is_gl_ready()) return {.id = 0, .locs = nullptr};
+
+    // shared by the nodes of the same type
+    LOADED_SHADERS.insert({vs_file_name, fs_file_name});
+    std::string vs = load_shader_src(vs_file_name);
+    std::string fs = load_shader_src(fs_file_name);
+    return load_cached_shader(vs, fs);
 }
 
 // -----------------------------------------------------------------------
@@ -50,243 +155,1777 @@ Shader load_shader(const std::string &vs_file_name, const std::string &fs_file_n
 class VideoSourceContext : public NodeContext {
 private:
     cv::VideoCapture capture;
+    // the camera is captured by the thread and only its latest frame is kept,
+    // files are read on each update so that no frame is skipped
+    bool is_live;
+    bool is_eof;
     std::thread capture_thread;
     std::atomic<bool> stop;
     std::mutex mutex;
     cv::Mat frame;
+    // get_stamp_ns() when the capture returned the frame
+    int64_t grab_ns;
+    // 0 if unknown
+    double fps;
     Texture texture;
+    SourceKernel cpu_kernel;
+
+    // must be called under the mutex
+    void get_scaled_frame(cv::Mat &dst) {
+        if (proxy_scale <= 1) {
+            dst = frame;
+            return;
+        }
+
+        cv::Size size(
+            std::max(1, frame.cols / proxy_scale), std::max(1, frame.rows / proxy_scale)
+        );
+        cv::resize(frame, dst, size, 0, 0, cv::INTER_AREA);
+    }
 
     static void capture_frames(
         cv::VideoCapture &capture,
         cv::Mat &out_frame,
+        int64_t &out_grab_ns,
         std::atomic<bool> &stop,
         std::mutex &mutex
     ) {
+        set_trace_thread_name("capture");
         cv::Mat bgr;
         while (!stop) {
-            capture >> bgr;
+            {
+                TraceScope scope("capture", "grab");
+                capture >> bgr;
+            }
+            int64_t grab_ns = get_stamp_ns();
             // TODO: validate properly that frame is not empty
 
             std::lock_guard<std::mutex> lock(mutex);
+            TraceScope scope("capture", "cvtColor");
             cv::cvtColor(bgr, out_frame, cv::COLOR_BGR2RGB);
+            out_grab_ns = grab_ns;
+        }
+    }
+
+    void read_file_frame() {
+        cv::Mat bgr;
+        {
+            TraceScope scope("capture", "read");
+            capture >> bgr;
+        }
+        grab_ns = get_stamp_ns();
+        if (bgr.empty()) {
+            is_eof = true;
+            frame.release();
+            return;
         }
+        TraceScope scope("capture", "cvtColor");
+        cv::cvtColor(bgr, frame, cv::COLOR_BGR2RGB);
     }
 
 public:
-    VideoSourceContext()
-        : capture(0)
-        , stop(false) {
+    // the default camera if empty
+    std::string file_name;
+
+    VideoSourceContext(std::string file_name = "")
+        : is_live(file_name.empty())
+        , is_eof(false)
+        , stop(false)
+        , grab_ns(0)
+        , fps(0.0)
+        , cpu_kernel([this](cv::Mat &dst, FrameStamp &stamp) {
+            read_frame(dst, stamp);
+        })
+        , file_name(file_name) {
+        if (is_live) {
+            capture.open(0);
+        } else {
+            capture.open(file_name);
+        }
+
         if (!capture.isOpened()) {
             throw std::runtime_error("Failed to open video capture\n");
         }
-
-        int frame_width = capture.get(cv::CAP_PROP_FRAME_WIDTH);
-        int frame_height = capture.get(cv::CAP_PROP_FRAME_HEIGHT);
-
-        texture = {
-            .id = rlLoadTexture(
-                0, frame_width, frame_height, RL_PIXELFORMAT_UNCOMPRESSED_R8G8B8, 1
-            ),
-            .width = frame_width,
-            .height = frame_height,
-            .mipmaps = 1,
-            .format = RL_PIXELFORMAT_UNCOMPRESSED_R8G8B8};
-
-        capture_thread = std::thread(
-            capture_frames,
-            std::ref(capture),
-            std::ref(frame),
-            std::ref(stop),
-            std::ref(mutex)
-        );
+        fps = capture.get(cv::CAP_PROP_FPS);
+
+        // allocated on the first frame, reallocated when the proxy scale changes
+        texture.id = 0;
+
+        if (is_live) {
+            capture_thread = std::thread(
+                capture_frames,
+                std::ref(capture),
+                std::ref(frame),
+                std::ref(grab_ns),
+                std::ref(stop),
+                std::ref(mutex)
+            );
+        }
     }
 
     ~VideoSourceContext() override {
         stop = true;
-        capture_thread.join();
+        if (capture_thread.joinable()) capture_thread.join();
         capture.release();
         UnloadTexture(texture);
     }
 
-    Texture get_texture() {
+    bool is_finished() override {
+        return is_eof;
+    }
+
+    // the graph updates faster than a camera, its frames are processed again
+    double get_fps() override {
+        return is_live ? 0.0 : fps;
+    }
+
+    // the stamp is of the frame in the texture
+    Texture get_texture(FrameStamp &stamp) {
         std::lock_guard<std::mutex> lock(mutex);
+        if (!is_live) read_file_frame();
+        if (frame.empty()) return texture;
+
+        cv::Mat scaled;
+        get_scaled_frame(scaled);
+        if (texture.id != 0
+            && (texture.width != scaled.cols || texture.height != scaled.rows)) {
+            UnloadTexture(texture);
+            texture.id = 0;
+        }
+
+        if (texture.id == 0) {
+            texture = {
+                .id = rlLoadTexture(
+                    0, scaled.cols, scaled.rows, RL_PIXELFORMAT_UNCOMPRESSED_R8G8B8, 1
+                ),
+                .width = scaled.cols,
+                .height = scaled.rows,
+                .mipmaps = 1,
+                .format = RL_PIXELFORMAT_UNCOMPRESSED_R8G8B8};
+        }
+
         // TODO: don't need to update texture on each get_texture() call
         // introduce need_update flag and update texture only when capture
         // is provided a new frame
-        UpdateTexture(texture, frame.data);
+        TraceScope scope("graph", "upload");
+        UpdateTexture(texture, scaled.data);
+        stamp = FrameStamp();
+        stamp.grab_ns = grab_ns;
+        stamp.pickup_ns = get_stamp_ns();
         return texture;
     }
 
+    void read_frame(cv::Mat &dst, FrameStamp &stamp) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!is_live) read_file_frame();
+        if (frame.empty()) {
+            dst.release();
+            return;
+        }
+
+        // u8, the consumers convert it to their precision
+        cv::Mat scaled;
+        get_scaled_frame(scaled);
+        scaled.copyTo(dst);
+        stamp = FrameStamp();
+        stamp.grab_ns = grab_ns;
+        stamp.pickup_ns = get_stamp_ns();
+    }
+
     void update(std::shared_ptr<Node> node) override {
         // TODO: put pins in some kind of map and access them by name,
         // not by index
-        node->pins[0]._texture = get_texture();
+        node->pins[0]._texture = get_texture(node->pins[0].stamp);
+    }
+
+    CpuKernel *get_cpu_kernel() override {
+        return &cpu_kernel;
     }
 };
 
 // -----------------------------------------------------------------------
-// color correction node
-class FrameProcessingContext : public NodeContext {
+// video writer node
+// Passes the frame through and records it to file_name while the record pin
+// is on, each recording overwrites the file. The frames are encoded on the
+// encoder thread, with the block pin off a full queue drops the frames, so
+// the preview never waits for the encoder.
+class VideoWriterContext : public NodeContext {
+private:
+    VideoEncoder encoder;
+    Readback readback;
+    // of the pending readbacks, oldest first
+    std::deque<FrameStamp> stamps;
+    SinkKernel cpu_kernel;
+
+    void record(const FrameStamp &stamp) {
+        if (latency) latency->record(stamp, get_stamp_ns());
+    }
+
+    // opens or closes the file when the record pin changes
+    EncoderPolicy prepare(std::vector<Pin> &pins) {
+        bool is_recording = get_pin(pins, "record")._bool;
+        if (is_recording && !encoder.is_open()) {
+            encoder.open(file_name, get_pin(pins, "fps")._int.val);
+        } else if (!is_recording && encoder.is_open()) {
+            encoder.close();
+        }
+        return get_pin(pins, "block")._bool ? EncoderPolicy::BLOCK
+                                            : EncoderPolicy::DROP;
+    }
+
+    void write(std::vector<Pin> &pins, const cv::Mat &frame) {
+        EncoderPolicy policy = prepare(pins);
+        if (!encoder.is_open()) return;
+
+        // the encoder keeps the frame, so it's always a copy
+        cv::Mat rgb;
+        if (frame.depth() == CV_8U) {
+            rgb = frame.clone();
+        } else {
+            convert_frame(frame, rgb, CV_8U);
+        }
+        if (encoder.push(rgb, policy)) record(pins[0].stamp);
+    }
+
+    // hands the completed readbacks to the encoder, wait drains all of them
+    void push_readbacks(EncoderPolicy policy, bool wait) {
+        auto push = [&](const unsigned char *rgba, int width, int height) {
+            FrameStamp stamp = stamps.front();
+            stamps.pop_front();
+            if (!rgba) {
+                encoder.n_dropped += 1;
+                return;
+            }
+
+            cv::Mat rgb;
+            cv::cvtColor(
+                cv::Mat(height, width, CV_8UC4, (void *)rgba), rgb, cv::COLOR_RGBA2RGB
+            );
+            if (encoder.push(rgb, policy)) record(stamp);
+        };
+        while (readback.poll(push, wait)) {
+        }
+    }
+
+public:
+    std::string file_name;
+    // records the frames reaching the encoder, set by the graph
+    LatencyStats *latency;
+
+    VideoWriterContext(std::string file_name)
+        : encoder(8)
+        , cpu_kernel([this](std::vector<Pin> &pins, const cv::Mat &frame) {
+            write(pins, frame);
+        })
+        , file_name(file_name)
+        , latency(nullptr) {}
+
+    ~VideoWriterContext() {
+        // the graph may be destroyed already
+        latency = nullptr;
+        // without a context the frames in flight are lost
+        if (is_gl_ready() && readback.get_n_pending()) {
+            push_readbacks(EncoderPolicy::BLOCK, true);
+        }
+    }
+
+    bool forwards_input() override {
+        return true;
+    }
+
+    void update(std::shared_ptr<Node> node) override {
+        auto &pins = node->pins;
+        Texture frame = pins[0]._texture;
+        pins.back()._texture = frame;
+
+        // the frames in flight still go to the file before it's closed
+        if (!get_pin(pins, "record")._bool && readback.get_n_pending()) {
+            push_readbacks(EncoderPolicy::BLOCK, true);
+        }
+
+        EncoderPolicy policy = prepare(pins);
+        if (!encoder.is_open()) return;
+
+        // the frame is handed to the encoder a frame or two later, a full
+        // readback ring is treated like a full encoder queue
+        if (IsTextureReady(frame)) {
+            bool is_read = readback.read(frame);
+            if (!is_read && policy == EncoderPolicy::BLOCK) {
+                push_readbacks(policy, true);
+                is_read = readback.read(frame);
+            }
+            if (is_read) {
+                stamps.push_back(pins[0].stamp);
+            } else {
+                encoder.n_dropped += 1;
+            }
+        }
+        push_readbacks(policy, false);
+    }
+
+    CpuKernel *get_cpu_kernel() override {
+        return &cpu_kernel;
+    }
+};
+
+// -----------------------------------------------------------------------
+// render target pool
+// The render targets released by the passes are kept by (width, height,
+// format) and handed to the next pass which needs the same kind, so the
+// intermediate frames of a chain share a few targets. See Graph::compile()
+// for when the outputs are released.
+class RenderTargetPool {
+private:
+    class FreeTarget {
+    public:
+        RenderTexture target;
+        // when it was released
+        int frame;
+    };
+
+    std::map<std::tuple<int, int, int>, std::vector<FreeTarget>> free_targets;
+    int frame;
+
+    // LoadRenderTexture() with the color format, it's always rgba8 there
+    static RenderTexture load_target(int width, int height, int format) {
+        RenderTexture target = {};
+        target.id = rlLoadFramebuffer();
+        if (target.id == 0) return target;
+
+        rlEnableFramebuffer(target.id);
+        target.texture = {
+            .id = rlLoadTexture(nullptr, width, height, format, 1),
+            .width = width,
+            .height = height,
+            .mipmaps = 1,
+            .format = format};
+        target.depth = {
+            .id = rlLoadTextureDepth(width, height, true),
+            .width = width,
+            .height = height,
+            .mipmaps = 1,
+            // what raylib sets, PixelFormat has no depth formats
+            .format = 19};
+        rlFramebufferAttach(
+            target.id,
+            target.texture.id,
+            RL_ATTACHMENT_COLOR_CHANNEL0,
+            RL_ATTACHMENT_TEXTURE2D,
+            0
+        );
+        rlFramebufferAttach(
+            target.id, target.depth.id, RL_ATTACHMENT_DEPTH, RL_ATTACHMENT_RENDERBUFFER, 0
+        );
+        if (!rlFramebufferComplete(target.id)) {
+            TraceLog(LOG_WARNING, "FBO: [ID %i] Render target is incomplete", target.id);
+        }
+        rlDisableFramebuffer();
+        return target;
+    }
+
+public:
+    // allocated targets, free ones included
+    int n_targets;
+
+    RenderTargetPool()
+        : frame(0)
+        , n_targets(0) {}
+
+    RenderTexture acquire(int width, int height, int format) {
+        auto &targets = free_targets[{width, height, format}];
+        if (!targets.empty()) {
+            RenderTexture target = targets.back().target;
+            targets.pop_back();
+            return target;
+        }
+
+        n_targets += 1;
+        return load_target(width, height, format);
+    }
+
+    void release(RenderTexture target) {
+        Texture texture = target.texture;
+        free_targets[{texture.width, texture.height, texture.format}].push_back(
+            {.target = target, .frame = frame}
+        );
+    }
+
+    // unloads the targets which stayed free for a whole frame, e.g. after
+    // the proxy scale change or the node deletion
+    void end_frame() {
+        for (auto &[_, targets] : free_targets) {
+            for (auto it = targets.begin(); it != targets.end();) {
+                if (it->frame >= frame) {
+                    ++it;
+                    continue;
+                }
+                UnloadRenderTexture(it->target);
+                n_targets -= 1;
+                it = targets.erase(it);
+            }
+        }
+        frame += 1;
+    }
+};
+
+// the targets live until the gl context is destroyed
+static RenderTargetPool &get_render_target_pool() {
+    static RenderTargetPool pool;
+    return pool;
+}
+
+// -----------------------------------------------------------------------
+// shader pass
+// The render target is taken from the pool on draw and stays with the pass
+// until release().
+class ShaderPass {
 private:
+    std::unordered_map<std::string, int> locations;
+
+public:
+    std::string fs_file_name;
     Shader shader;
+    RenderTexture render_texture;
+    // the Params block, empty if the shader doesn't declare it
+    UniformBlock params;
+    // SHADER_GENERATION of the shader
+    int generation;
+
+    ShaderPass(std::string fs_file_name)
+        : fs_file_name(fs_file_name)
+        , generation(-1) {
+        shader.id = 0;
+        render_texture.id = 0;
+        update_shader();
+    }
+
+    // takes the reloaded shader, the locations and the Params layout might
+    // have changed with it
+    void update_shader() {
+        if (generation == SHADER_GENERATION) return;
+        generation = SHADER_GENERATION;
+
+        Shader new_shader = load_shader("screen_rect.vert", fs_file_name);
+        if (new_shader.id == 0 || new_shader.id == shader.id) return;
+        shader = new_shader;
+        locations = get_uniform_locations(shader.id);
+        load_frame_block(shader.id);
+        params.load(shader.id, "Params", PARAMS_BINDING);
+    }
+
+    // -1 if the shader doesn't use the uniform
+    int get_location(const std::string &name) {
+        auto it = locations.find(name);
+        return it == locations.end() ? -1 : it->second;
+    }
+
+    // the shader is shared, see load_cached_shader()
+    ~ShaderPass() {
+        release();
+    }
+
+    void release() {
+        if (render_texture.id == 0) return;
+        get_render_target_pool().release(render_texture);
+        render_texture = {};
+    }
+
+    // renders with another shader into the target of the pass, set_values
+    // is called while the shader is active
+    void draw(
+        Shader shader,
+        Texture frame,
+        int width,
+        int height,
+        const std::function<void()> &set_values
+    ) {
+        if (!IsTextureReady(frame)) {
+            return;
+        }
+
+        Texture texture = render_texture.texture;
+        if (texture.width != width || texture.height != height) release();
+        if (render_texture.id == 0) {
+            render_texture = get_render_target_pool().acquire(
+                width, height, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+            );
+        }
+
+        BeginTextureMode(render_texture);
+        BeginShaderMode(shader);
+        set_values();
+        DrawRectangle(0, 0, 1, 1, BLANK);
+        EndShaderMode();
+        EndTextureMode();
+    }
+
+    // renders at width x height
+    void draw(
+        Texture frame, int width, int height, const std::function<void()> &set_values
+    ) {
+        update_shader();
+        draw(shader, frame, width, height, set_values);
+    }
+
+    // renders at the frame size
+    void draw(Texture frame, const std::function<void()> &set_values) {
+        draw(frame, frame.width, frame.height, set_values);
+    }
+
+    // one pass of a separable filter with radius and direction uniforms
+    void draw(Texture frame, int radius, Vector2 direction) {
+        draw(frame, [&]() {
+            SetShaderValueTexture(shader, get_location("frame"), frame);
+            SetShaderValue(shader, get_location("radius"), &radius, SHADER_UNIFORM_INT);
+            SetShaderValue(
+                shader, get_location("direction"), &direction, SHADER_UNIFORM_VEC2
+            );
+        });
+    }
+};
 
-    void set_shader_values(std::vector<Pin> &pins) {
-        float time = GetTime();
-        SetShaderValue(
-            shader, GetShaderLocation(shader, "time"), &time, SHADER_UNIFORM_FLOAT
+// -----------------------------------------------------------------------
+// compute pass
+// Runs the compute shader of a node over the frame into a render target of
+// the pool, see tile.glsl. The shader is built for each halo, rounded up so
+// that the radius pins share a few variants.
+
+// TILE_SIZE of tile.glsl
+static const int COMPUTE_TILE_SIZE = 16;
+
+static bool IS_COMPUTE_ENABLED = true;
+
+void set_compute_enabled(bool is_enabled) {
+    IS_COMPUTE_ENABLED = is_enabled;
+}
+
+// get_src returns the source of a file, the reload passes its new sources
+static std::string get_compute_shader_src(
+    const std::string &fs_file_name,
+    const std::string &cs_file_name,
+    int halo,
+    const std::function<std::string(const std::string &)> &get_src = read_shader_file
+) {
+    return "#version 430 core\n#define HALO " + std::to_string(halo) + "\n"
+           + get_src("common.glsl") + "\n" + get_src("tile.glsl") + "\n"
+           + get_stage_src(get_src(fs_file_name)) + get_src(cs_file_name);
+}
+
+class ComputePass {
+private:
+    class Variant {
+    public:
+        Shader shader;
+        std::unordered_map<std::string, int> locations;
+        // SHADER_GENERATION of the shader
+        int generation;
+
+        int get_location(const std::string &name) {
+            auto it = locations.find(name);
+            return it == locations.end() ? -1 : it->second;
+        }
+    };
+
+    std::string fs_file_name;
+    std::string cs_file_name;
+    // by halo, nullptr if the shader can't run
+    std::unordered_map<int, std::unique_ptr<Variant>> variants;
+
+    // compute shaders need 4.3, the drivers without it fail the compilation,
+    // the reload prebuilds the new variants, a variant which still fails to
+    // build keeps its last good shader
+    Variant *get_variant(int halo) {
+        auto &variant = variants[halo];
+        if (variant && variant->generation == SHADER_GENERATION) return variant.get();
+        if (!glDispatchCompute) return nullptr;
+
+        std::string src = get_compute_shader_src(fs_file_name, cs_file_name, halo);
+        Shader shader = load_cached_compute_shader(src);
+        if (shader.id == rlGetShaderIdDefault()) {
+            if (variant) variant->generation = SHADER_GENERATION;
+            return variant.get();
+        }
+
+        LOADED_COMPUTE_SHADERS.insert({fs_file_name, cs_file_name, halo});
+        variant = std::make_unique<Variant>();
+        variant->shader = shader;
+        variant->locations = get_uniform_locations(shader.id);
+        variant->generation = SHADER_GENERATION;
+        load_frame_block(shader.id);
+        set_block_binding(shader.id, "Params", PARAMS_BINDING);
+        return variant.get();
+    }
+
+public:
+    RenderTexture render_texture;
+
+    ComputePass(std::string fs_file_name, std::string cs_file_name)
+        : fs_file_name(fs_file_name)
+        , cs_file_name(cs_file_name) {
+        render_texture.id = 0;
+    }
+
+    ~ComputePass() {
+        release();
+    }
+
+    void release() {
+        if (render_texture.id == 0) return;
+        get_render_target_pool().release(render_texture);
+        render_texture = {};
+    }
+
+    // the halo must cover the farthest tap in pixels, set_values is called
+    // while the shader is active, false if the pass can't run
+    bool dispatch(Texture frame, int halo, const std::function<void()> &set_values) {
+        if (!IS_COMPUTE_ENABLED) return false;
+        Variant *variant = get_variant((halo + 3) / 4 * 4);
+        if (!variant) return false;
+        if (!IsTextureReady(frame)) return true;
+
+        Texture texture = render_texture.texture;
+        if (texture.width != frame.width || texture.height != frame.height) release();
+        if (render_texture.id == 0) {
+            render_texture = get_render_target_pool().acquire(
+                frame.width, frame.height, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+            );
+        }
+
+        // rlgl binds its own program and textures before the next batch draw
+        rlDrawRenderBatchActive();
+        glUseProgram(variant->shader.id);
+        set_values();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, frame.id);
+        glUniform1i(variant->get_location("frame"), 0);
+        int blue_noise_loc = variant->get_location("blue_noise");
+        if (blue_noise_loc != -1) {
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, get_blue_noise().get_texture().id);
+            glUniform1i(blue_noise_loc, 1);
+            glActiveTexture(GL_TEXTURE0);
+        }
+        glUniform1i(variant->get_location("out_frame"), 0);
+        glBindImageTexture(
+            0, render_texture.texture.id, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8
         );
 
-        for (auto &pin : pins) {
-            if (pin.kind == PinKind::OUTPUT) continue;
-            int loc = GetShaderLocation(shader, pin.name.c_str());
+        int n_x = (frame.width + COMPUTE_TILE_SIZE - 1) / COMPUTE_TILE_SIZE;
+        int n_y = (frame.height + COMPUTE_TILE_SIZE - 1) / COMPUTE_TILE_SIZE;
+        glDispatchCompute(n_x, n_y, 1);
+        // the next passes sample the output
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        return true;
+    }
+};
+
+// -----------------------------------------------------------------------
+// color correction node
+class FrameProcessingContext : public NodeContext {
+private:
+    CpuKernel *cpu_kernel;
+
+    // by pin index: the sampler location of a texture pin, the Params
+    // offset of the others, -1 if the shader doesn't use the pin
+    std::vector<int> pin_locations;
+    // ShaderPass::generation of the locations
+    int pin_generation;
+
+    friend class FusedPass;
+
+protected:
+    ShaderPass pass;
+    // INT pins in full resolution pixels, the shaders get them at the proxy
+    // resolution
+    std::vector<std::string> pixel_pin_names;
+    // nullptr for the nodes without a compute shader
+    std::unique_ptr<ComputePass> compute;
+
+    // writes the pins to the Params block, the buffer is bound by the caller
+    void set_params(std::vector<Pin> &pins) {
+        pass.update_shader();
+        if (pin_locations.size() != pins.size() || pin_generation != pass.generation) {
+            pin_generation = pass.generation;
+            pin_locations.clear();
+            for (auto &pin : pins) {
+                bool is_texture = pin.type == PinType::TEXTURE;
+                pin_locations.push_back(
+                    is_texture ? pass.get_location(pin.name)
+                               : pass.params.get_offset(pin.name)
+                );
+            }
+        }
+
+        // std140 scalars are 4 bytes, bools included, vec3 is 3 floats
+        for (size_t i = 0; i < pins.size(); ++i) {
+            Pin &pin = pins[i];
+            int loc = pin_locations[i];
+            if (pin.kind == PinKind::OUTPUT || loc == -1) continue;
 
             switch (pin.type) {
-                case PinType::INT:
-                    SetShaderValue(shader, loc, &pin._int.val, SHADER_UNIFORM_INT);
-                    break;
-                case PinType::FLOAT:
-                    SetShaderValue(shader, loc, &pin._float.val, SHADER_UNIFORM_FLOAT);
-                    break;
-                case PinType::COLOR:
-                    SetShaderValue(shader, loc, &pin._color, SHADER_UNIFORM_VEC3);
+                case PinType::INT: {
+                    int val = is_pixel_pin(pin) ? get_pixels(pins, pin.name)
+                                                : pin._int.val;
+                    pass.params.set(loc, &val, 4);
                     break;
-                case PinType::TEXTURE:
-                    SetShaderValueTexture(shader, loc, pin._texture);
+                }
+                case PinType::FLOAT: pass.params.set(loc, &pin._float.val, 4); break;
+                case PinType::BOOL: {
+                    int val = pin._bool;
+                    pass.params.set(loc, &val, 4);
                     break;
+                }
+                case PinType::COLOR: pass.params.set(loc, &pin._color, 12); break;
+                case PinType::TEXTURE: break;
             }
         }
     }
 
-public:
-    RenderTexture render_texture;
+    bool is_pixel_pin(const Pin &pin) {
+        auto &names = pixel_pin_names;
+        return std::find(names.begin(), names.end(), pin.name) != names.end();
+    }
 
-    FrameProcessingContext(std::string fs_file_name) {
-        shader = load_shader("screen_rect.vert", fs_file_name);
-        render_texture.id = 0;
+    // the value of a pin in pixels at the proxy resolution
+    int get_pixels(std::vector<Pin> &pins, const std::string &name) {
+        return get_proxy_pixels(get_pin(pins, name)._int.val, proxy_scale);
+    }
+
+    virtual void set_shader_values(std::vector<Pin> &pins) {
+        Shader shader = pass.shader;
+        set_params(pins);
+
+        // only bound for the shaders which sample it, each sampler takes a slot
+        int blue_noise_loc = pass.get_location("blue_noise");
+        if (blue_noise_loc != -1) {
+            Texture texture = get_blue_noise().get_texture();
+            SetShaderValueTexture(shader, blue_noise_loc, texture);
+        }
+
+        for (size_t i = 0; i < pins.size(); ++i) {
+            Pin &pin = pins[i];
+            int loc = pin_locations[i];
+            if (pin.kind == PinKind::OUTPUT || loc == -1) continue;
+            if (pin.type == PinType::TEXTURE) {
+                SetShaderValueTexture(shader, loc, pin._texture);
+            }
+        }
+        pass.params.bind();
+    }
+
+    // the distance of the farthest tap of the compute shader in pixels, -1 to
+    // draw the fragment shader
+    virtual int get_compute_halo(std::vector<Pin> &pins) {
+        return -1;
+    }
+
+public:
+    FrameProcessingContext(
+        std::string fs_file_name,
+        CpuKernel *cpu_kernel = nullptr,
+        std::string cs_file_name = ""
+    )
+        : cpu_kernel(cpu_kernel)
+        , pin_generation(0)
+        , pass(fs_file_name) {
+        if (!cs_file_name.empty()) {
+            compute = std::make_unique<ComputePass>(fs_file_name, cs_file_name);
+        }
     }
 
     ~FrameProcessingContext() {
-        UnloadShader(shader);
-        UnloadRenderTexture(render_texture);
+        delete cpu_kernel;
+    }
+
+    void draw(std::vector<Pin> &pins) {
+        // TODO: put pins in some kind of map and access them by name,
+        // not by index
+        pass.draw(pins[0]._texture, [&]() { set_shader_values(pins); });
+    }
+
+    void update(std::shared_ptr<Node> node) override {
+        auto &pins = node->pins;
+        int halo = compute ? get_compute_halo(pins) : -1;
+        auto set_values = [&]() {
+            set_params(pins);
+            pass.params.bind();
+        };
+        if (halo != -1 && compute->dispatch(pins[0]._texture, halo, set_values)) {
+            pass.release();
+            pins.back()._texture = compute->render_texture.texture;
+            return;
+        }
+
+        if (compute) compute->release();
+        draw(pins);
+        pins.back()._texture = pass.render_texture.texture;
+    }
+
+    void release_targets() override {
+        pass.release();
+        if (compute) compute->release();
+    }
+
+    CpuKernel *get_cpu_kernel() override {
+        return cpu_kernel;
+    }
+
+    // POINTWISE shaders define vec3 apply(vec3 color) and GATHER ones
+    // vec2 map(vec2 uv), such nodes are drawn by fused passes, see FusedPass
+    virtual CpuKernelKind get_fused_kind(std::vector<Pin> &pins) {
+        auto kind = cpu_kernel ? cpu_kernel->get_kind(pins) : CpuKernelKind::FRAME;
+        bool is_fusible = kind == CpuKernelKind::POINTWISE
+                          || kind == CpuKernelKind::GATHER;
+        return is_fusible ? kind : CpuKernelKind::FRAME;
+    }
+
+    // the nodes which draw passes of their own before the shader only start
+    // the fused runs
+    virtual bool has_prepass(std::vector<Pin> &pins) {
+        return false;
+    }
+
+    // the texture the shader samples
+    virtual Texture draw_prepass(std::vector<Pin> &pins) {
+        return pins[0]._texture;
+    }
+
+    virtual void release_prepass() {}
+};
+
+// -----------------------------------------------------------------------
+// color quantization node
+class ColorQuantizationContext : public FrameProcessingContext {
+private:
+    ShaderPass blur_x;
+    ShaderPass blur_y;
+
+public:
+    ColorQuantizationContext()
+        : FrameProcessingContext(
+            "color_quantization.frag",
+            new ColorQuantizationKernel([this]() { return proxy_scale; }),
+            "color_quantization.comp"
+        )
+        , blur_x("box_blur.frag")
+        , blur_y("box_blur.frag") {
+        pixel_pin_names = {"radius"};
+    }
+
+    // the poisson disc taps are within radius / 2 pixels
+    int get_compute_halo(std::vector<Pin> &pins) override {
+        if (get_pin(pins, "fast_blur")._bool) return -1;
+        return (get_pixels(pins, "radius") + 1) / 2 + 1;
+    }
+
+    // with fast_blur the quantization is pointwise on the blurred frame
+    CpuKernelKind get_fused_kind(std::vector<Pin> &pins) override {
+        return get_pin(pins, "fast_blur")._bool ? CpuKernelKind::POINTWISE
+                                                : CpuKernelKind::FRAME;
+    }
+
+    bool has_prepass(std::vector<Pin> &pins) override {
+        return get_pin(pins, "fast_blur")._bool;
+    }
+
+    Texture draw_prepass(std::vector<Pin> &pins) override {
+        Texture frame = pins[0]._texture;
+        if (!get_pin(pins, "fast_blur")._bool) return frame;
+
+        int radius = get_pixels(pins, "radius");
+        blur_x.draw(frame, radius, {1.0, 0.0});
+        blur_y.draw(blur_x.render_texture.texture, radius, {0.0, 1.0});
+        return blur_y.render_texture.texture;
+    }
+
+    void release_prepass() override {
+        blur_x.release();
+        blur_y.release();
+    }
+
+    void update(std::shared_ptr<Node> node) override {
+        auto &pins = node->pins;
+        Texture frame = pins[0]._texture;
+
+        // with fast_blur the quantization pass reads the blurred frame as is
+        pins[0]._texture = draw_prepass(pins);
+        FrameProcessingContext::update(node);
+        pins[0]._texture = frame;
+        release_prepass();
+    }
+};
+
+// -----------------------------------------------------------------------
+// color outline node
+class ColorOutlineContext : public FrameProcessingContext {
+private:
+    ShaderPass edges;
+    ShaderPass dilate_x;
+    ShaderPass dilate_y;
+
+protected:
+    void set_shader_values(std::vector<Pin> &pins) override {
+        FrameProcessingContext::set_shader_values(pins);
+        Texture texture = dilate_y.render_texture.texture;
+        if (texture.id == 0) return;
+
+        SetShaderValueTexture(pass.shader, pass.get_location("edges"), texture);
+    }
+
+public:
+    ColorOutlineContext()
+        : FrameProcessingContext(
+            "color_outline.frag",
+            new ColorOutlineKernel([this]() { return proxy_scale; }),
+            "color_outline.comp"
+        )
+        , edges("outline_edges.frag")
+        , dilate_x("max_filter.frag")
+        , dilate_y("max_filter.frag") {
+        pixel_pin_names = {"radius"};
+    }
+
+    int get_compute_halo(std::vector<Pin> &pins) override {
+        if (get_pin(pins, "fast_outline")._bool) return -1;
+        return (get_pixels(pins, "radius") + 1) / 2 + 1;
+    }
+
+    void update(std::shared_ptr<Node> node) override {
+        auto &pins = node->pins;
+        Texture frame = pins[0]._texture;
+
+        // gradient magnitude dilated by the poisson disc radius, the cost
+        // doesn't depend on n_samples
+        if (get_pin(pins, "fast_outline")._bool) {
+            int radius = (get_pixels(pins, "radius") + 1) / 2;
+            edges.draw(frame, [&]() {
+                SetShaderValueTexture(edges.shader, edges.get_location("frame"), frame);
+            });
+            dilate_x.draw(edges.render_texture.texture, radius, {1.0, 0.0});
+            dilate_y.draw(dilate_x.render_texture.texture, radius, {0.0, 1.0});
+        }
+
+        FrameProcessingContext::update(node);
+        edges.release();
+        dilate_x.release();
+        dilate_y.release();
+    }
+};
+
+// -----------------------------------------------------------------------
+// shader fusion
+// A run of POINTWISE and GATHER nodes, same as a fused step of the cpu
+// backend, is drawn by a single shader generated from the node shaders: uv
+// goes through the map() functions of the gathers from the last one to the
+// first one, the sampled color then goes through the apply() functions.
+
+// each node of a run binds its own Params block, the drivers limit the blocks
+// of a shader to at least 12
+static const size_t MAX_FUSED_NODES = 8;
+
+// nullptr for the nodes which aren't drawn by a single shader pass
+static FrameProcessingContext *get_frame_context(std::shared_ptr<Node> node) {
+    return dynamic_cast<FrameProcessingContext *>(node->context);
+}
+
+// fused shader sources by the signature of the run, cleared by the reload
+static std::unordered_map<std::string, std::string> FUSED_SRCS;
+
+static std::string get_fused_shader_src(
+    const std::vector<std::string> &fs_file_names,
+    const std::vector<CpuKernelKind> &kinds
+) {
+    std::string src = "in vec2 vs_uv;\nuniform sampler2D frame;\nout vec4 fs_color;\n";
+    std::string map_src;
+    std::string apply_src;
+    for (size_t i = 0; i < fs_file_names.size(); ++i) {
+        std::string prefix = "s" + std::to_string(i) + "_";
+        src += get_stage_src(read_shader_file(fs_file_names[i]), prefix);
+        if (kinds[i] == CpuKernelKind::GATHER) {
+            map_src = "    uv = " + prefix + "map(uv);\n" + map_src;
+        } else {
+            apply_src += "    color = " + prefix + "apply(color);\n";
+        }
+    }
+    src += "void main() {\n    vec2 uv = vs_uv;\n" + map_src
+           + "    vec3 color = texture(frame, uv).rgb;\n" + apply_src
+           + "    fs_color = vec4(color, 1.0);\n}\n";
+    return get_full_shader_src(src);
+}
+
+// The shader is built in the background, the nodes of the run are drawn one
+// by one until it's done.
+class FusedPass {
+private:
+    std::unique_ptr<ShaderBuild> build;
+    Shader shader;
+    std::unordered_map<std::string, int> locations;
+
+    int get_location(const std::string &name) {
+        auto it = locations.find(name);
+        return it == locations.end() ? -1 : it->second;
+    }
+
+public:
+    // the output goes to the pass of the last node
+    std::vector<std::shared_ptr<Node>> nodes;
+
+    FusedPass(std::vector<std::shared_ptr<Node>> nodes)
+        : shader({.id = 0, .locs = nullptr})
+        , nodes(nodes) {
+        std::vector<std::string> fs_file_names;
+        std::vector<CpuKernelKind> kinds;
+        std::string signature;
+        for (auto &node : nodes) {
+            auto context = get_frame_context(node);
+            auto kind = context->get_fused_kind(node->pins);
+            fs_file_names.push_back(context->pass.fs_file_name);
+            kinds.push_back(kind);
+            signature += fs_file_names.back();
+            signature += kind == CpuKernelKind::GATHER ? ":map " : ":apply ";
+        }
+
+        // the programs are cached by their sources, this skips generating them
+        auto it = FUSED_SRCS.find(signature);
+        if (it == FUSED_SRCS.end()) {
+            auto src = get_fused_shader_src(fs_file_names, kinds);
+            it = FUSED_SRCS.emplace(signature, src).first;
+        }
+        std::string vs = load_shader_src("screen_rect.vert");
+        build = std::make_unique<ShaderBuild>(vs, it->second);
+    }
+
+    // called once per frame before the nodes are updated
+    void poll() {
+        if (shader.id != 0 || !build->is_done()) return;
+
+        shader = build->get_shader();
+        load_frame_block(shader.id);
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            std::string name = "s" + std::to_string(i) + "_Params";
+            set_block_binding(shader.id, name, PARAMS_BINDING + i);
+        }
+        locations = get_uniform_locations(shader.id);
+    }
+
+    // the fallback shader of a failed compilation doesn't have the frame
+    bool is_ready() {
+        return get_location("frame") != -1;
+    }
+
+    // a due preview inside the run, only the last output exists when fused
+    bool has_due_preview() {
+        for (size_t i = 0; i + 1 < nodes.size(); ++i) {
+            if (nodes[i]->is_preview_due) return true;
+        }
+        return false;
+    }
+
+    void draw() {
+        auto first = get_frame_context(nodes[0]);
+        auto last = get_frame_context(nodes.back());
+        Texture frame = first->draw_prepass(nodes[0]->pins);
+
+        last->pass.draw(shader, frame, frame.width, frame.height, [&]() {
+            SetShaderValueTexture(shader, get_location("frame"), frame);
+            int blue_noise_loc = get_location("blue_noise");
+            if (blue_noise_loc != -1) {
+                Texture texture = get_blue_noise().get_texture();
+                SetShaderValueTexture(shader, blue_noise_loc, texture);
+            }
+
+            for (size_t i = 0; i < nodes.size(); ++i) {
+                auto context = get_frame_context(nodes[i]);
+                context->set_params(nodes[i]->pins);
+                context->pass.params.bind(PARAMS_BINDING + i);
+            }
+        });
+
+        first->release_prepass();
+        nodes.back()->pins.back()._texture = last->pass.render_texture.texture;
+    }
+};
+
+// runs are built the same way as the fused steps of the cpu backend
+static void compile_fused_passes(Graph &graph) {
+    graph.fused_passes.clear();
+    if (!is_gl_ready()) return;
+
+    std::vector<std::vector<std::shared_ptr<Node>>> runs;
+    // index of each run which can still be extended, by its last node id
+    std::unordered_map<int, int> open_runs;
+
+    for (int id : graph.order) {
+        auto node = graph.nodes[id];
+        auto context = get_frame_context(node);
+        if (!context) continue;
+        auto kind = context->get_fused_kind(node->pins);
+        if (kind == CpuKernelKind::FRAME) continue;
+
+        auto input = graph.get_input_node(node);
+        int run_idx;
+        if (input && open_runs.count(input->id) && !context->has_prepass(node->pins)) {
+            run_idx = open_runs[input->id];
+            open_runs.erase(input->id);
+            runs[run_idx].push_back(node);
+        } else {
+            run_idx = runs.size();
+            runs.push_back({node});
+        }
+
+        // the previews split the run while they're due, see Graph::update()
+        bool is_materialized = graph.get_n_consumers(node) != 1;
+        bool is_full = runs[run_idx].size() == MAX_FUSED_NODES;
+        if (!is_materialized && !is_full) open_runs[id] = run_idx;
+    }
+
+    for (auto &run : runs) {
+        if (run.size() < 2) continue;
+        auto pass = std::make_shared<FusedPass>(run);
+        for (auto &node : run) graph.fused_passes[node->id] = pass;
+    }
+}
+
+// -----------------------------------------------------------------------
+// shader reload
+// The changed files are built in the background together with the files they
+// are used with. Their sources replace the old ones only once all of these
+// shaders are built, the passes then take the new shaders before their next
+// draw. On a failure the old shaders stay.
+class ShaderReload {
+public:
+    // new sources by file name
+    std::unordered_map<std::string, std::string> srcs;
+    std::vector<std::unique_ptr<ShaderBuild>> builds;
+};
+
+static std::unique_ptr<ShaderReload> SHADER_RELOAD;
+// changed while a reload is pending
+static std::vector<std::string> CHANGED_SHADER_FILES;
+
+void reload_shaders(const std::vector<std::string> &file_names) {
+    CHANGED_SHADER_FILES.insert(
+        CHANGED_SHADER_FILES.end(), file_names.begin(), file_names.end()
+    );
+}
+
+static void start_shader_reload() {
+    auto reload = std::make_unique<ShaderReload>();
+    for (auto &name : CHANGED_SHADER_FILES) {
+        // e.g. the temporary files of the editors
+        if (!SHADER_SRCS.count(name)) continue;
+        std::string src = read_file("shaders/" + name);
+        if (src != SHADER_SRCS[name]) reload->srcs[name] = src;
+    }
+    CHANGED_SHADER_FILES.clear();
+    if (reload->srcs.empty()) return;
+
+    auto get_src = [&](const std::string &name) {
+        auto it = reload->srcs.find(name);
+        return it != reload->srcs.end() ? it->second : read_shader_file(name);
+    };
+    std::string common_src = get_src("common.glsl");
+    for (auto &[vs_file_name, fs_file_name] : LOADED_SHADERS) {
+        bool is_changed = reload->srcs.count("common.glsl")
+                          || reload->srcs.count(vs_file_name)
+                          || reload->srcs.count(fs_file_name);
+        if (!is_changed) continue;
+
+        reload->builds.push_back(std::make_unique<ShaderBuild>(
+            get_full_shader_src(get_src(vs_file_name), common_src),
+            get_full_shader_src(get_src(fs_file_name), common_src)
+        ));
+    }
+    // the compute variants are rebuilt by the next dispatch, which would
+    // block, so the used ones are prebuilt and the dispatch finds them cached
+    for (auto &[fs_file_name, cs_file_name, halo] : LOADED_COMPUTE_SHADERS) {
+        bool is_changed = reload->srcs.count("common.glsl")
+                          || reload->srcs.count("tile.glsl")
+                          || reload->srcs.count(fs_file_name)
+                          || reload->srcs.count(cs_file_name);
+        if (!is_changed) continue;
+
+        reload->builds.push_back(std::make_unique<ShaderBuild>(
+            get_compute_shader_src(fs_file_name, cs_file_name, halo, get_src)
+        ));
+    }
+    SHADER_RELOAD = std::move(reload);
+}
+
+// true when the new shaders are swapped in, called on each frame
+static bool update_shader_reload() {
+    if (!SHADER_RELOAD) {
+        if (!CHANGED_SHADER_FILES.empty()) start_shader_reload();
+        return false;
+    }
+    for (auto &build : SHADER_RELOAD->builds) {
+        if (!build->is_done()) return false;
+    }
+
+    auto reload = std::move(SHADER_RELOAD);
+    for (auto &build : reload->builds) {
+        if (!build->is_failed()) continue;
+        TraceLog(LOG_WARNING, "SHADER: Reload failed, keeping the old shaders");
+        return false;
+    }
+
+    for (auto &[name, src] : reload->srcs) {
+        TraceLog(LOG_INFO, "SHADER: Reloaded %s", name.c_str());
+        SHADER_SRCS[name] = src;
+    }
+    FUSED_SRCS.clear();
+    SHADER_GENERATION += 1;
+    return true;
+}
+
+// -----------------------------------------------------------------------
+// thumbnails
+// seconds a thumbnail is kept without being requested
+static const double THUMBNAIL_TIMEOUT = 5.0;
+
+class Thumbnail {
+public:
+    ShaderPass pass;
+    // GetTime() of the last draw and the last request
+    double draw_time;
+    double use_time;
+    // of the last request
+    int width;
+    bool is_due;
+
+    Thumbnail()
+        : pass("downsample.frag")
+        , draw_time(0.0)
+        , use_time(0.0)
+        , width(0)
+        , is_due(false) {}
+
+    void draw(Texture texture) {
+        // downsample.frag averages whole pixel_size blocks, so the thumbnail
+        // is between width and 2 * width wide
+        int pixel_size = std::max(1, texture.width / width);
+        int thumbnail_width = (texture.width + pixel_size - 1) / pixel_size;
+        int thumbnail_height = (texture.height + pixel_size - 1) / pixel_size;
+        pass.draw(texture, thumbnail_width, thumbnail_height, [&]() {
+            int pixel_size_loc = pass.get_location("pixel_size");
+            SetShaderValueTexture(pass.shader, pass.get_location("frame"), texture);
+            SetShaderValue(pass.shader, pixel_size_loc, &pixel_size, SHADER_UNIFORM_INT);
+        });
+    }
+};
+
+Thumbnails::Thumbnails()
+    : refresh_rate(15.0) {}
+
+Texture Thumbnails::get(const Pin &pin, int width) {
+    auto &thumbnail = thumbnails[pin.id];
+    if (!thumbnail) thumbnail = std::make_shared<Thumbnail>();
+    double time = GetTime();
+    thumbnail->use_time = time;
+    thumbnail->width = width;
+    thumbnail->is_due = time - thumbnail->draw_time >= 1.0 / refresh_rate;
+    return thumbnail->pass.render_texture.texture;
+}
+
+Texture Thumbnails::find(int pin_id) {
+    auto it = thumbnails.find(pin_id);
+    if (it == thumbnails.end()) return {};
+    return it->second->pass.render_texture.texture;
+}
+
+void Thumbnails::prepare(Graph &graph) {
+    for (auto &[pin_id, thumbnail] : thumbnails) {
+        auto pin = graph.pins.find(pin_id);
+        if (!thumbnail->is_due || pin == graph.pins.end()) continue;
+
+        // a forwarded output is the target of the input node
+        auto node = graph.nodes[pin->second->node_id];
+        while (node && !node->is_preview_due) {
+            node->is_preview_due = true;
+            if (!node->context->forwards_input()) break;
+            node = graph.get_input_node(node);
+        }
+    }
+}
+
+void Thumbnails::update(Graph &graph) {
+    double time = GetTime();
+    for (auto it = thumbnails.begin(); it != thumbnails.end();) {
+        auto &thumbnail = it->second;
+        auto pin = graph.pins.find(it->first);
+        if (pin == graph.pins.end() || time - thumbnail->use_time > THUMBNAIL_TIMEOUT) {
+            it = thumbnails.erase(it);
+            continue;
+        }
+
+        // a due thumbnail of an empty output waits for the next request
+        Texture texture = pin->second->_texture;
+        if (thumbnail->is_due && IsTextureReady(texture)) {
+            thumbnail->draw(texture);
+            thumbnail->draw_time = time;
+            stamps.push_back(pin->second->stamp);
+        }
+        thumbnail->is_due = false;
+        ++it;
+    }
+    for (auto &[_, node] : graph.nodes) node->is_preview_due = false;
+}
+
+std::vector<FrameStamp> Thumbnails::take_stamps() {
+    std::vector<FrameStamp> taken;
+    taken.swap(stamps);
+    return taken;
+}
+
+// -----------------------------------------------------------------------
+// graph
+// atomic, the batch runner builds a graph on each worker thread
+static std::atomic<int> NEXT_ID = 1;
+
+int get_next_id() {
+    return NEXT_ID++;
+}
+
+// the ids up to max_id are taken by the loaded nodes
+static void reserve_ids(int max_id) {
+    int id = NEXT_ID;
+    while (id <= max_id && !NEXT_ID.compare_exchange_weak(id, max_id + 1)) {
+    }
+}
+
+Pin::Pin() = default;
+Pin Pin::create_int(PinKind kind, std::string name, int val, int min, int max) {
+    Pin pin;
+    pin.type = PinType::INT;
+    pin.kind = kind;
+    pin.name = name;
+    pin._int.val = val;
+    pin._int.min = min;
+    pin._int.max = max;
+    return pin;
+}
+
+Pin Pin::create_float(PinKind kind, std::string name, float val, float min, float max) {
+    Pin pin;
+    pin.type = PinType::FLOAT;
+    pin.kind = kind;
+    pin.name = name;
+    pin._float.val = val;
+    pin._float.min = min;
+    pin._float.max = max;
+    return pin;
+}
+
+Pin Pin::create_bool(PinKind kind, std::string name, bool val) {
+    Pin pin;
+    pin.type = PinType::BOOL;
+    pin.kind = kind;
+    pin.name = name;
+    pin._bool = val;
+    return pin;
+}
+
+Pin Pin::create_texture(PinKind kind, std::string name) {
+    Pin pin;
+    pin.type = PinType::TEXTURE;
+    pin._texture.id = 0;
+    pin.kind = kind;
+    pin.name = name;
+    return pin;
+}
+
+Pin Pin::create_color(PinKind kind, std::string name, Vector3 val) {
+    Pin pin;
+    pin.type = PinType::COLOR;
+    pin.kind = kind;
+    pin.name = name;
+    pin._color = val;
+    return pin;
+}
+
+Pin &get_pin(std::vector<Pin> &pins, const std::string &name) {
+    for (auto &pin : pins) {
+        if (pin.kind != PinKind::OUTPUT && pin.name == name) return pin;
+    }
+    throw std::runtime_error("Failed to find pin " + name);
+}
+
+int get_proxy_pixels(int pixels, int proxy_scale) {
+    return std::max(1, (int)std::lround((float)pixels / proxy_scale));
+}
+
+Node::Node() = default;
+Node::Node(std::string name, std::vector<Pin> pins, NodeContext *context)
+    : name(name)
+    , pins(pins)
+    , preview(true)
+    , is_preview_due(false)
+    , context(context) {}
+Node::~Node() {
+    delete (NodeContext *)context;
+}
+
+NodeFactory::NodeFactory(std::string name, std::function<std::shared_ptr<Node>()> fn)
+    : name(name)
+    , create(fn) {}
+
+Link::Link() = default;
+Link::Link(int start_pin_id, int end_pin_id)
+    : start_pin_id(start_pin_id)
+    , end_pin_id(end_pin_id) {}
+
+void Graph::transfer_links(std::shared_ptr<Node> node) {
+    TraceScope scope("graph", "transfer_links");
+    for (auto &end_pin : node->pins) {
+        if (end_pin.kind != PinKind::INPUT || end_pin.link_ids.empty()) continue;
+
+        Link &link = this->links[*end_pin.link_ids.begin()];
+        Pin *start_pin = this->pins[link.start_pin_id];
+        switch (start_pin->type) {
+            case PinType::INT:
+                end_pin._int.val = std::clamp(
+                    start_pin->_int.val, end_pin._int.min, end_pin._int.max
+                );
+                break;
+            case PinType::FLOAT:
+                end_pin._float.val = std::clamp(
+                    start_pin->_float.val, end_pin._float.min, end_pin._float.max
+                );
+                break;
+            case PinType::BOOL: end_pin._bool = start_pin->_bool; break;
+            case PinType::COLOR: end_pin._color = start_pin->_color; break;
+            case PinType::TEXTURE:
+                end_pin._texture = start_pin->_texture;
+                end_pin.stamp = start_pin->stamp;
+                break;
+        }
+    }
+
+    // the sources stamp their own frames in update()
+    Pin &output = node->pins.back();
+    if (node->pins[0].kind == PinKind::INPUT && output.kind == PinKind::OUTPUT) {
+        output.stamp = node->pins[0].stamp;
+    }
+}
+
+std::shared_ptr<Node> Graph::get_input_node(std::shared_ptr<Node> node) {
+    auto &link_ids = node->pins[0].link_ids;
+    if (node->pins[0].kind != PinKind::INPUT || link_ids.empty()) return nullptr;
+
+    Link &link = this->links[*link_ids.begin()];
+    return this->nodes[this->pins[link.start_pin_id]->node_id];
+}
+
+int Graph::get_n_consumers(std::shared_ptr<Node> node) {
+    return node->pins.back().link_ids.size();
+}
+
+void Graph::compile() {
+    // Kahn's algorithm, nodes with equal depth are ordered by id
+    std::unordered_map<int, int> n_inputs;
+    for (auto &[id, node] : this->nodes) {
+        n_inputs[id] = 0;
+    }
+    for (auto &[_, link] : this->links) {
+        n_inputs[this->pins[link.end_pin_id]->node_id] += 1;
+    }
+
+    std::vector<int> ready;
+    for (auto &[id, n] : n_inputs) {
+        if (n == 0) ready.push_back(id);
+    }
+
+    this->order.clear();
+    while (!ready.empty()) {
+        std::sort(ready.begin(), ready.end(), std::greater<int>());
+        int id = ready.back();
+        ready.pop_back();
+        this->order.push_back(id);
+
+        for (auto &pin : this->nodes[id]->pins) {
+            if (pin.kind != PinKind::OUTPUT) continue;
+            for (int link_id : pin.link_ids) {
+                int end_node_id = this->pins[this->links[link_id].end_pin_id]->node_id;
+                if (--n_inputs[end_node_id] == 0) ready.push_back(end_node_id);
+            }
+        }
+    }
+
+    // nodes on cycles are still updated, just after everything else
+    std::vector<int> rest;
+    for (auto &[id, n] : n_inputs) {
+        if (n > 0) rest.push_back(id);
+    }
+    std::sort(rest.begin(), rest.end());
+    this->order.insert(this->order.end(), rest.begin(), rest.end());
+    compile_fused_passes(*this);
+
+    // the output of a node is released after its last consumer ran, the
+    // targets then go back to the pool and are reused by the following nodes,
+    // sinks and the outputs read back on a cycle are kept, the due previews
+    // are kept in update()
+    std::unordered_map<int, int> positions;
+    for (size_t i = 0; i < this->order.size(); ++i) positions[this->order[i]] = i;
+    // the fused nodes read their inputs when the last node of the run is drawn
+    for (auto &[id, pass] : this->fused_passes) {
+        positions[id] = positions[pass->nodes.back()->id];
+    }
+
+    // position after which the output is no longer read, -1 if it's kept
+    std::vector<int> last_uses(this->order.size(), -1);
+    for (int i = this->order.size() - 1; i >= 0; --i) {
+        auto node = this->nodes[this->order[i]];
+        if (get_n_consumers(node) == 0) continue;
+
+        int last_use = i;
+        for (int link_id : node->pins.back().link_ids) {
+            int end_node_id = this->pins[this->links[link_id].end_pin_id]->node_id;
+            int position = positions[end_node_id];
+            auto end_node = this->nodes[end_node_id];
+            if (end_node->context->forwards_input()) position = last_uses[position];
+            if (position <= i) {
+                last_use = -1;
+                break;
+            }
+            last_use = std::max(last_use, position);
+        }
+        last_uses[i] = last_use;
+    }
+
+    this->releases.assign(this->order.size(), {});
+    for (size_t i = 0; i < this->order.size(); ++i) {
+        if (last_uses[i] != -1) this->releases[last_uses[i]].push_back(this->order[i]);
+    }
+
+    this->cpu_backend->compile(*this);
+    this->is_dirty = false;
+}
+
+// the frames of the outputs are final until the next update
+static void stamp_outputs(Graph &graph) {
+    int64_t time = get_stamp_ns();
+    for (auto &[_, node] : graph.nodes) {
+        Pin &pin = node->pins.back();
+        if (pin.kind == PinKind::OUTPUT && pin.stamp.grab_ns) pin.stamp.done_ns = time;
+    }
+}
+
+void Graph::update() {
+    TraceScope scope("graph", "update");
+    // the fused passes are rebuilt with the new shaders
+    if (update_shader_reload()) this->is_dirty = true;
+    if (this->is_dirty) compile();
+
+    this->frame_idx += 1;
+    // the gpu nodes also run as the cpu backend fallback
+    if (is_gl_ready()) update_frame_uniforms(get_time(), this->frame_idx);
+
+    for (auto &[_, node] : this->nodes) {
+        node->context->proxy_scale = this->proxy_scale;
+        if (auto writer = dynamic_cast<VideoWriterContext *>(node->context)) {
+            writer->latency = &this->latency;
+        }
+    }
+
+    if (this->backend == Backend::CPU) {
+        this->cpu_backend->update(*this);
+        this->profiler.end_frame();
+        stamp_outputs(*this);
+        return;
+    }
+
+    for (auto &[id, pass] : this->fused_passes) {
+        if (pass->nodes.back()->id == id) pass->poll();
+    }
+
+    for (size_t i = 0; i < this->order.size(); ++i) {
+        auto node = this->nodes[this->order[i]];
+        transfer_links(node);
+
+        // a run with a due preview is drawn node by node for this update
+        auto it = this->fused_passes.find(node->id);
+        if (it == this->fused_passes.end() || !it->second->is_ready()
+            || it->second->has_due_preview()) {
+            TraceScope node_scope("node", node->name.c_str());
+            this->profiler.begin(node->id);
+            node->context->update(node);
+            this->profiler.end();
+        } else if (it->second->nodes.back() == node) {
+            TraceScope node_scope("node", node->name.c_str());
+            this->profiler.begin(node->id);
+            it->second->draw();
+            this->profiler.end();
+        }
+        for (int id : this->releases[i]) {
+            auto released = this->nodes[id];
+            if (!released->is_preview_due) released->context->release_targets();
+        }
+    }
+    this->profiler.end_frame();
+    stamp_outputs(*this);
+    if (is_gl_ready()) get_render_target_pool().end_frame();
+}
+
+// of the graphs without a file source, the frame rate of the editor
+static const double DEFAULT_FPS = 60.0;
+
+float Graph::get_time() {
+    double fps = 0.0;
+    for (auto &[_, node] : this->nodes) fps = std::max(fps, node->context->get_fps());
+    return this->frame_idx / (fps > 0.0 ? fps : DEFAULT_FPS);
+}
+
+// -----------------------------------------------------------------------
+// pixelization node
+class PixelizationContext : public FrameProcessingContext {
+private:
+    ShaderPass downsample;
+
+public:
+    PixelizationContext()
+        : FrameProcessingContext(
+            "pixelization.frag", new PixelizationKernel([this]() { return proxy_scale; })
+        )
+        , downsample("downsample.frag") {
+        pixel_pin_names = {"pixel_size"};
     }
 
-    void draw(std::vector<Pin> &pins) {
-        // TODO: put pins in some kind of map and access them by name,
-        // not by index
+    void update(std::shared_ptr<Node> node) override {
+        auto &pins = node->pins;
         Texture frame = pins[0]._texture;
-        if (render_texture.id == 0 && IsTextureReady(frame)) {
-            render_texture = LoadRenderTexture(frame.width, frame.height);
-        }
-
-        if (render_texture.id == 0 || !IsTextureReady(frame)) {
+        if (!get_pin(pins, "downsample")._bool) {
+            downsample.release();
+            FrameProcessingContext::update(node);
             return;
         }
-
-        BeginTextureMode(render_texture);
-        BeginShaderMode(shader);
-        set_shader_values(pins);
-        DrawRectangle(0, 0, 1, 1, BLANK);
-        EndShaderMode();
-        EndTextureMode();
+        pass.release();
+
+        // emit a pixel_size times smaller frame, so the downstream nodes
+        // don't process the repeated pixels, it's scaled up only on display
+        int pixel_size = get_pixels(pins, "pixel_size");
+        int width = (frame.width + pixel_size - 1) / pixel_size;
+        int height = (frame.height + pixel_size - 1) / pixel_size;
+        downsample.draw(frame, width, height, [&]() {
+            Shader shader = downsample.shader;
+            int pixel_size_loc = downsample.get_location("pixel_size");
+            SetShaderValueTexture(shader, downsample.get_location("frame"), frame);
+            SetShaderValue(shader, pixel_size_loc, &pixel_size, SHADER_UNIFORM_INT);
+        });
+        pins.back()._texture = downsample.render_texture.texture;
     }
 
-    void update(std::shared_ptr<Node> node) override {
-        draw(node->pins);
-        node->pins.back()._texture = render_texture.texture;
+    void release_targets() override {
+        FrameProcessingContext::release_targets();
+        downsample.release();
     }
 };
 
 // -----------------------------------------------------------------------
-// graph
-int get_next_id() {
-    static int id = 1;
-    return id++;
-}
+// scale node
+class ScaleContext : public FrameProcessingContext {
+private:
+    ScaleKernel *kernel;
 
-Pin::Pin() = default;
-Pin Pin::create_int(PinKind kind, std::string name, int val, int min, int max) {
-    Pin pin;
-    pin.type = PinType::INT;
-    pin.kind = kind;
-    pin.name = name;
-    pin._int.val = val;
-    pin._int.min = min;
-    pin._int.max = max;
-    return pin;
-}
+public:
+    ScaleContext()
+        : ScaleContext(new ScaleKernel([this]() { return proxy_scale; })) {}
 
-Pin Pin::create_float(PinKind kind, std::string name, float val, float min, float max) {
-    Pin pin;
-    pin.type = PinType::FLOAT;
-    pin.kind = kind;
-    pin.name = name;
-    pin._float.val = val;
-    pin._float.min = min;
-    pin._float.max = max;
-    return pin;
-}
+    ScaleContext(ScaleKernel *kernel)
+        : FrameProcessingContext("scale.frag", kernel)
+        , kernel(kernel) {}
 
-Pin Pin::create_texture(PinKind kind, std::string name) {
-    Pin pin;
-    pin.type = PinType::TEXTURE;
-    pin._texture.id = 0;
-    pin.kind = kind;
-    pin.name = name;
-    return pin;
-}
+    void update(std::shared_ptr<Node> node) override {
+        auto &pins = node->pins;
+        Texture frame = pins[0]._texture;
 
-Pin Pin::create_color(PinKind kind, std::string name, Vector3 val) {
-    Pin pin;
-    pin.type = PinType::COLOR;
-    pin.kind = kind;
-    pin.name = name;
-    pin._color = val;
-    return pin;
-}
+        kernel->prepare(pins);
+        cv::Size size = kernel->get_size(frame.width, frame.height);
+        pass.draw(frame, size.width, size.height, [&]() {
+            int out_size[2] = {size.width, size.height};
+            int out_size_loc = pass.get_location("out_size");
+            set_shader_values(pins);
+            SetShaderValue(pass.shader, out_size_loc, out_size, SHADER_UNIFORM_IVEC2);
+        });
+        pins.back()._texture = pass.render_texture.texture;
+    }
+};
 
-Node::Node() = default;
-Node::Node(std::string name, std::vector<Pin> pins, NodeContext *context)
-    : name(name)
-    , pins(pins)
-    , context(context) {}
-Node::~Node() {
-    delete (NodeContext *)context;
-}
+// -----------------------------------------------------------------------
+// warp nodes
+// With cached_remap the warp is evaluated on the cpu into the kernel's
+// remap table once per parameter or size change, each frame is then just
+// a remap.frag lookup.
+class WarpContext : public FrameProcessingContext {
+private:
+    WarpKernel *kernel;
+    ShaderPass remap;
+    Texture table_texture;
+    int table_version;
+
+    void upload_table() {
+        cv::Mat &uv = kernel->table.uv;
+        if (table_texture.id != 0
+            && (table_texture.width != uv.cols || table_texture.height != uv.rows)) {
+            UnloadTexture(table_texture);
+            table_texture.id = 0;
+        }
 
-NodeFactory::NodeFactory(std::string name, std::function<std::shared_ptr<Node>()> fn)
-    : name(name)
-    , create(fn) {}
+        if (table_texture.id == 0) {
+            table_texture = {
+                .id = rlLoadTexture(
+                    0, uv.cols, uv.rows, RL_PIXELFORMAT_UNCOMPRESSED_R32G32B32, 1
+                ),
+                .width = uv.cols,
+                .height = uv.rows,
+                .mipmaps = 1,
+                .format = RL_PIXELFORMAT_UNCOMPRESSED_R32G32B32};
+        }
 
-Link::Link() = default;
-Link::Link(int start_pin_id, int end_pin_id)
-    : start_pin_id(start_pin_id)
-    , end_pin_id(end_pin_id) {}
+        UpdateTexture(table_texture, uv.data);
+        table_version = kernel->table.version;
+    }
 
-void Graph::update() {
-    // TODO: this is incorrect! Nodes must be sorted topologically
-    for (auto [name, node] : this->nodes) {
-        node->context->update(node);
+public:
+    WarpContext(std::string fs_file_name, WarpKernel *kernel)
+        : FrameProcessingContext(fs_file_name, kernel)
+        , kernel(kernel)
+        , remap("remap.frag")
+        , table_version(0) {
+        table_texture.id = 0;
     }
 
-    for (auto &[_, link] : this->links) {
-        Pin *start_pin = this->pins[link.start_pin_id];
-        Pin *end_pin = this->pins[link.end_pin_id];
-        switch (start_pin->type) {
-            case PinType::INT:
-                end_pin->_int.val = std::clamp(
-                    start_pin->_int.val, end_pin->_int.min, end_pin->_int.max
-                );
-                break;
-            case PinType::FLOAT:
-                end_pin->_float.val = std::clamp(
-                    start_pin->_float.val, end_pin->_float.min, end_pin->_float.max
-                );
-                break;
-            case PinType::COLOR: end_pin->_color = start_pin->_color; break;
-            case PinType::TEXTURE: end_pin->_texture = start_pin->_texture; break;
+    ~WarpContext() {
+        UnloadTexture(table_texture);
+    }
+
+    void update(std::shared_ptr<Node> node) override {
+        auto &pins = node->pins;
+        Texture frame = pins[0]._texture;
+        if (!get_pin(pins, "cached_remap")._bool || !IsTextureReady(frame)) {
+            remap.release();
+            FrameProcessingContext::update(node);
+            return;
         }
+        pass.release();
+
+        kernel->prepare(pins);
+        kernel->update_table(frame.width, frame.height);
+        if (kernel->table.version != table_version) upload_table();
+
+        remap.draw(frame, [&]() {
+            SetShaderValueTexture(remap.shader, remap.get_location("frame"), frame);
+            SetShaderValueTexture(
+                remap.shader, remap.get_location("remap"), table_texture
+            );
+        });
+        pins.back()._texture = remap.render_texture.texture;
     }
-}
+
+    void release_targets() override {
+        FrameProcessingContext::release_targets();
+        remap.release();
+    }
+};
 
 std::shared_ptr<Node> create_video_source_node() {
     auto name = "Video Source";
@@ -298,9 +1937,35 @@ std::shared_ptr<Node> create_video_source_node() {
     return node;
 }
 
+std::shared_ptr<Node> create_video_file_node(std::string file_name) {
+    auto name = "Video File";
+    auto context = new VideoSourceContext(file_name);
+    auto pins = {
+        Pin::create_texture(PinKind::OUTPUT, "frame"),
+    };
+    std::shared_ptr<Node> node(new Node(name, pins, context));
+    return node;
+}
+
+std::shared_ptr<Node> create_video_writer_node(std::string file_name) {
+    auto name = "Video Writer";
+    auto context = new VideoWriterContext(file_name.empty() ? "freska.avi" : file_name);
+    auto pins = {
+        Pin::create_texture(PinKind::INPUT, "frame"),
+        Pin::create_bool(PinKind::MANUAL, "record", false),
+        Pin::create_bool(PinKind::MANUAL, "block", false),
+        Pin::create_int(PinKind::MANUAL, "fps", 30, 1, 120),
+        Pin::create_texture(PinKind::OUTPUT, "frame"),
+    };
+    std::shared_ptr<Node> node(new Node(name, pins, context));
+    return node;
+}
+
 std::shared_ptr<Node> create_color_correction_node() {
     auto name = "Color Correction";
-    auto context = new FrameProcessingContext("color_correction.frag");
+    auto context = new FrameProcessingContext(
+        "color_correction.frag", new ColorCorrectionKernel()
+    );
     auto pins = {
         Pin::create_texture(PinKind::INPUT, "frame"),
         Pin::create_color(PinKind::MANUAL, "white_balance", {1.0, 1.0, 1.0}),
@@ -318,12 +1983,14 @@ std::shared_ptr<Node> create_color_correction_node() {
 
 std::shared_ptr<Node> create_color_quantization_node() {
     auto name = "Color Quantization";
-    auto context = new FrameProcessingContext("color_quantization.frag");
+    auto context = new ColorQuantizationContext();
     auto pins = {
         Pin::create_texture(PinKind::INPUT, "frame"),
         Pin::create_int(PinKind::MANUAL, "n_levels", 4, 1, 16),
-        Pin::create_int(PinKind::MANUAL, "n_samples", 64, 4, 87),
+        Pin::create_int(PinKind::MANUAL, "n_samples", 16, 4, 87),
         Pin::create_int(PinKind::MANUAL, "radius", 16, 1, 32),
+        Pin::create_bool(PinKind::MANUAL, "temporal_noise", false),
+        Pin::create_bool(PinKind::MANUAL, "fast_blur", false),
         Pin::create_texture(PinKind::OUTPUT, "frame"),
     };
     std::shared_ptr<Node> node(new Node(name, pins, context));
@@ -332,13 +1999,15 @@ std::shared_ptr<Node> create_color_quantization_node() {
 
 std::shared_ptr<Node> create_color_outline_node() {
     auto name = "Color Outline";
-    auto context = new FrameProcessingContext("color_outline.frag");
+    auto context = new ColorOutlineContext();
     auto pins = {
         Pin::create_texture(PinKind::INPUT, "frame"),
         Pin::create_color(PinKind::MANUAL, "color", {0.0, 0.0, 0.0}),
         Pin::create_float(PinKind::MANUAL, "threshold", 0.06, 0.0, 0.2),
-        Pin::create_int(PinKind::MANUAL, "n_samples", 64, 4, 87),
+        Pin::create_int(PinKind::MANUAL, "n_samples", 16, 4, 87),
         Pin::create_int(PinKind::MANUAL, "radius", 16, 1, 32),
+        Pin::create_bool(PinKind::MANUAL, "temporal_noise", false),
+        Pin::create_bool(PinKind::MANUAL, "fast_outline", false),
         Pin::create_texture(PinKind::OUTPUT, "frame"),
     };
     std::shared_ptr<Node> node(new Node(name, pins, context));
@@ -347,7 +2016,7 @@ std::shared_ptr<Node> create_color_outline_node() {
 
 std::shared_ptr<Node> create_old_tv_node() {
     auto name = "Old TV";
-    auto context = new FrameProcessingContext("old_tv.frag");
+    auto context = new FrameProcessingContext("old_tv.frag", new OldTvKernel());
     auto pins = {
         Pin::create_texture(PinKind::INPUT, "frame"),
         Pin::create_float(PinKind::MANUAL, "vert_jerk", 0.0, 0.0, 1.0),
@@ -364,10 +2033,11 @@ std::shared_ptr<Node> create_old_tv_node() {
 
 std::shared_ptr<Node> create_fisheye_node() {
     auto name = "Fisheye";
-    auto context = new FrameProcessingContext("fisheye.frag");
+    auto context = new WarpContext("fisheye.frag", new FisheyeKernel());
     auto pins = {
         Pin::create_texture(PinKind::INPUT, "frame"),
         Pin::create_float(PinKind::MANUAL, "strength", 0.0, -0.5, 0.5),
+        Pin::create_bool(PinKind::MANUAL, "cached_remap", false),
         Pin::create_texture(PinKind::OUTPUT, "frame"),
     };
     std::shared_ptr<Node> node(new Node(name, pins, context));
@@ -376,18 +2046,39 @@ std::shared_ptr<Node> create_fisheye_node() {
 
 std::shared_ptr<Node> create_pixelization_node() {
     auto name = "Pixelization";
-    auto context = new FrameProcessingContext("pixelization.frag");
+    auto context = new PixelizationContext();
     auto pins = {
         Pin::create_texture(PinKind::INPUT, "frame"),
         Pin::create_int(PinKind::MANUAL, "pixel_size", 4, 1, 16),
+        Pin::create_bool(PinKind::MANUAL, "downsample", false),
+        Pin::create_texture(PinKind::OUTPUT, "frame"),
+    };
+    std::shared_ptr<Node> node(new Node(name, pins, context));
+    return node;
+}
+
+std::shared_ptr<Node> create_scale_node() {
+    auto name = "Scale";
+    auto context = new ScaleContext();
+    auto pins = {
+        Pin::create_texture(PinKind::INPUT, "frame"),
+        Pin::create_int(PinKind::MANUAL, "width", 0, 0, 7680),
+        Pin::create_int(PinKind::MANUAL, "height", 0, 0, 4320),
+        Pin::create_float(PinKind::MANUAL, "scale", 0.5, 0.05, 4.0),
+        Pin::create_bool(PinKind::MANUAL, "nearest", false),
         Pin::create_texture(PinKind::OUTPUT, "frame"),
     };
     std::shared_ptr<Node> node(new Node(name, pins, context));
     return node;
 }
 
-Graph::Graph() {
-    this->node_factories.emplace_back("Vide Source", create_video_source_node);
+Graph::Graph()
+    : backend(Backend::GPU)
+    , cpu_backend(std::make_shared<CpuBackend>())
+    , proxy_scale(1)
+    , frame_idx(0)
+    , is_dirty(true) {
+    this->node_factories.emplace_back("Video Source", create_video_source_node);
     this->node_factories.emplace_back("Color Correction", create_color_correction_node);
     this->node_factories.emplace_back(
         "Color Quantization", create_color_quantization_node
@@ -396,6 +2087,10 @@ Graph::Graph() {
     this->node_factories.emplace_back("Old TV", create_old_tv_node);
     this->node_factories.emplace_back("Fisheye", create_fisheye_node);
     this->node_factories.emplace_back("Pixelization", create_pixelization_node);
+    this->node_factories.emplace_back("Scale", create_scale_node);
+    this->node_factories.emplace_back("Video Writer", [] {
+        return create_video_writer_node("");
+    });
 }
 
 void Graph::delete_node(int node_id) {
@@ -411,6 +2106,8 @@ void Graph::delete_node(int node_id) {
     }
 
     this->nodes.erase(node->id);
+    this->profiler.timings.erase(node->id);
+    this->is_dirty = true;
 }
 
 void Graph::delete_link(int link_id) {
@@ -422,6 +2119,7 @@ void Graph::delete_link(int link_id) {
     pin0->link_ids.erase(link.id);
     pin1->link_ids.erase(link.id);
     this->links.erase(link.id);
+    this->is_dirty = true;
 }
 
 bool Graph::can_create_link(Link link) {
@@ -464,12 +2162,17 @@ int Graph::create_link(Link link) {
     pin0->link_ids.insert(link.id);
     pin1->link_ids.insert(link.id);
     this->links[link.id] = link;
+    this->is_dirty = true;
 
     return link.id;
 }
 
-int Graph::create_node(std::shared_ptr<Node> node) {
-    int id = get_next_id();
+int Graph::create_node(std::shared_ptr<Node> node, int id) {
+    if (id == 0) {
+        id = get_next_id();
+    } else {
+        reserve_ids(id);
+    }
     node->id = id;
 
     for (auto &pin : node->pins) {
@@ -480,5 +2183,501 @@ int Graph::create_node(std::shared_ptr<Node> node) {
     }
 
     this->nodes[id] = node;
+    this->is_dirty = true;
+    return id;
+}
+
+std::shared_ptr<Node> Graph::create_node_by_name(
+    const std::string &name, const std::string &file_name
+) {
+    if (name == "Video File") return create_video_file_node(file_name);
+    if (name == "Video Writer") return create_video_writer_node(file_name);
+    for (auto &factory : this->node_factories) {
+        if (factory.name == name) return factory.create();
+    }
+    throw std::runtime_error("Unknown node " + name);
+}
+
+void Graph::clear() {
+    std::vector<int> node_ids;
+    for (auto &[id, _] : this->nodes) node_ids.push_back(id);
+    for (int id : node_ids) delete_node(id);
+}
+
+// -----------------------------------------------------------------------
+// graph file
+// The JSON form references the pins by name. The binary form is a header and
+// arrays of fixed size records with 4 byte little-endian fields, it's mapped
+// and read in place, with the pins referenced by index.
+static const char GRAPH_FILE_MAGIC[4] = {'F', 'R', 'S', 'K'};
+static const uint32_t GRAPH_FILE_VERSION = 1;
+
+struct GraphFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t n_nodes;
+    uint32_t n_values;
+    uint32_t n_links;
+    uint32_t strings_size;
+};
+
+struct GraphFileNode {
+    uint32_t id;
+    // offsets in the string table
+    uint32_t name;
+    uint32_t file_name;
+    uint32_t preview;
+    // a range of the values array
+    uint32_t first_value;
+    uint32_t n_values;
+};
+
+struct GraphFileValue {
+    uint32_t pin;
+    uint32_t type;
+    union {
+        int32_t _int;
+        float _float;
+        uint32_t _bool;
+        float _color[3];
+    };
+};
+
+struct GraphFileLink {
+    uint32_t start_node;
+    uint32_t start_pin;
+    uint32_t end_node;
+    uint32_t end_pin;
+};
+
+static std::string get_file_name(std::shared_ptr<Node> node) {
+    if (auto source = dynamic_cast<VideoSourceContext *>(node->context)) {
+        return source->file_name;
+    }
+    if (auto writer = dynamic_cast<VideoWriterContext *>(node->context)) {
+        return writer->file_name;
+    }
+    return "";
+}
+
+static int get_pin_idx(std::shared_ptr<Node> node, int pin_id) {
+    for (size_t i = 0; i < node->pins.size(); ++i) {
+        if (node->pins[i].id == pin_id) return i;
+    }
+    return -1;
+}
+
+static bool ends_with(const std::string &str, const std::string &suffix) {
+    return str.size() >= suffix.size()
+           && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// nodes and links ordered by id, so the files are stable
+template <typename T>
+static std::vector<int> get_sorted_ids(const std::unordered_map<int, T> &map) {
+    std::vector<int> ids;
+    for (auto &[id, _] : map) ids.push_back(id);
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+static void save_json(Graph &graph, const std::string &file_name) {
+    using namespace crude_json;
+
+    value nodes(type_t::array);
+    for (int id : get_sorted_ids(graph.nodes)) {
+        auto node = graph.nodes[id];
+        value values(type_t::object);
+        for (auto &pin : node->pins) {
+            if (pin.kind != PinKind::MANUAL) continue;
+            switch (pin.type) {
+                case PinType::INT: values[pin.name] = (number)pin._int.val; break;
+                case PinType::FLOAT: values[pin.name] = (number)pin._float.val; break;
+                case PinType::BOOL: values[pin.name] = pin._bool; break;
+                case PinType::COLOR: {
+                    Vector3 c = pin._color;
+                    values[pin.name] = array{(number)c.x, (number)c.y, (number)c.z};
+                    break;
+                }
+                case PinType::TEXTURE: break;
+            }
+        }
+
+        value json_node(type_t::object);
+        json_node["id"] = (number)id;
+        json_node["name"] = node->name;
+        json_node["preview"] = node->preview;
+        json_node["values"] = std::move(values);
+        std::string node_file_name = get_file_name(node);
+        if (!node_file_name.empty()) json_node["file_name"] = node_file_name;
+        nodes.push_back(std::move(json_node));
+    }
+
+    value links(type_t::array);
+    for (int id : get_sorted_ids(graph.links)) {
+        Link &link = graph.links[id];
+        Pin *start_pin = graph.pins[link.start_pin_id];
+        Pin *end_pin = graph.pins[link.end_pin_id];
+
+        value json_link(type_t::object);
+        json_link["start_node"] = (number)start_pin->node_id;
+        json_link["start_pin"] = start_pin->name;
+        json_link["end_node"] = (number)end_pin->node_id;
+        json_link["end_pin"] = end_pin->name;
+        links.push_back(std::move(json_link));
+    }
+
+    value root(type_t::object);
+    root["version"] = (number)GRAPH_FILE_VERSION;
+    root["nodes"] = std::move(nodes);
+    root["links"] = std::move(links);
+    if (!root.save(file_name, 4)) {
+        throw std::runtime_error("Failed to save graph to " + file_name);
+    }
+}
+
+static Pin &get_pin_by_kind(
+    std::shared_ptr<Node> node, const std::string &name, bool is_output
+) {
+    for (auto &pin : node->pins) {
+        bool is_pin_output = pin.kind == PinKind::OUTPUT;
+        if (pin.name == name && is_pin_output == is_output) return pin;
+    }
+    throw std::runtime_error("Failed to find pin " + name + " of " + node->name);
+}
+
+template <typename T> static T &get_json(crude_json::value &value) {
+    T *ptr = value.get_ptr<T>();
+    if (!ptr) throw std::runtime_error("Unexpected JSON value type in graph file");
+    return *ptr;
+}
+
+// checked before the cast, an out of range double cast to int is undefined
+static int get_json_id(crude_json::value &value) {
+    double id = get_json<crude_json::number>(value);
+    if (!(id >= 1 && id <= INT32_MAX / 2) || id != std::floor(id)) {
+        throw std::runtime_error("Invalid id in graph file");
+    }
     return id;
 }
+
+// clamped to the range of the pin like the editor sliders, e.g. a radius
+// sizes the halo and the allocations of the kernels
+static void set_loaded_value(Pin &pin, double value) {
+    if (std::isnan(value)) throw std::runtime_error("Invalid value in graph file");
+    if (pin.type == PinType::INT) {
+        pin._int.val = std::clamp(value, (double)pin._int.min, (double)pin._int.max);
+    } else {
+        pin._float.val = std::clamp(
+            value, (double)pin._float.min, (double)pin._float.max
+        );
+    }
+}
+
+static void load_json(Graph &graph, const std::string &file_name) {
+    using namespace crude_json;
+
+    auto [root, is_loaded] = value::load(file_name);
+    if (!is_loaded || !root.is_object()) {
+        throw std::runtime_error("Failed to load graph from " + file_name);
+    }
+
+    auto &nodes = get_json<array>(root["nodes"]);
+    auto &links = get_json<array>(root["links"]);
+    graph.nodes.reserve(nodes.size());
+    graph.links.reserve(links.size());
+
+    // a duplicate id would replace a node whose pins are still in graph.pins
+    int max_node_id = 0;
+    std::unordered_set<int> node_ids;
+    for (auto &json_node : nodes) {
+        int id = get_json_id(json_node["id"]);
+        if (!node_ids.insert(id).second) {
+            throw std::runtime_error("Invalid node id in " + file_name);
+        }
+        max_node_id = std::max(max_node_id, id);
+    }
+    // the pins and links get the ids after all the loaded node ids, so the
+    // editor never sees the same id twice
+    reserve_ids(max_node_id);
+
+    for (auto &json_node : nodes) {
+        std::string node_file_name;
+        if (json_node.contains("file_name")) {
+            node_file_name = get_json<string>(json_node["file_name"]);
+        }
+        auto node = graph.create_node_by_name(
+            get_json<string>(json_node["name"]), node_file_name
+        );
+        node->preview = get_json<boolean>(json_node["preview"]);
+
+        for (auto &[name, json_value] : get_json<object>(json_node["values"])) {
+            Pin &pin = get_pin(node->pins, name);
+            switch (pin.type) {
+                case PinType::INT:
+                case PinType::FLOAT:
+                    set_loaded_value(pin, get_json<number>(json_value));
+                    break;
+                case PinType::BOOL: pin._bool = get_json<boolean>(json_value); break;
+                case PinType::COLOR: {
+                    auto &c = get_json<array>(json_value);
+                    if (c.size() != 3) throw std::runtime_error("Expected R,G,B");
+                    pin._color = {
+                        (float)get_json<number>(c[0]),
+                        (float)get_json<number>(c[1]),
+                        (float)get_json<number>(c[2])};
+                    break;
+                }
+                case PinType::TEXTURE: break;
+            }
+        }
+
+        graph.create_node(node, get_json_id(json_node["id"]));
+    }
+
+    for (auto &json_link : links) {
+        auto start_node = graph.nodes.at(get_json_id(json_link["start_node"]));
+        auto end_node = graph.nodes.at(get_json_id(json_link["end_node"]));
+        Pin &start_pin = get_pin_by_kind(
+            start_node, get_json<string>(json_link["start_pin"]), true
+        );
+        Pin &end_pin = get_pin_by_kind(
+            end_node, get_json<string>(json_link["end_pin"]), false
+        );
+        Link link(start_pin.id, end_pin.id);
+        if (!graph.can_create_link(link)) {
+            throw std::runtime_error("Invalid link in " + file_name);
+        }
+        graph.create_link(link);
+    }
+}
+
+static void save_binary(Graph &graph, const std::string &file_name) {
+    std::vector<GraphFileNode> nodes;
+    std::vector<GraphFileValue> values;
+    std::vector<GraphFileLink> links;
+    // offset 0 is the empty string
+    std::string strings(1, '\0');
+
+    auto add_string = [&](const std::string &str) -> uint32_t {
+        if (str.empty()) return 0;
+        uint32_t offset = strings.size();
+        strings += str;
+        strings += '\0';
+        return offset;
+    };
+
+    for (int id : get_sorted_ids(graph.nodes)) {
+        auto node = graph.nodes[id];
+        GraphFileNode file_node = {
+            .id = (uint32_t)id,
+            .name = add_string(node->name),
+            .file_name = add_string(get_file_name(node)),
+            .preview = node->preview,
+            .first_value = (uint32_t)values.size(),
+            .n_values = 0};
+
+        for (size_t i = 0; i < node->pins.size(); ++i) {
+            Pin &pin = node->pins[i];
+            if (pin.kind != PinKind::MANUAL || pin.type == PinType::TEXTURE) continue;
+
+            GraphFileValue value = {};
+            value.pin = i;
+            value.type = (uint32_t)pin.type;
+            switch (pin.type) {
+                case PinType::INT: value._int = pin._int.val; break;
+                case PinType::FLOAT: value._float = pin._float.val; break;
+                case PinType::BOOL: value._bool = pin._bool; break;
+                case PinType::COLOR:
+                    value._color[0] = pin._color.x;
+                    value._color[1] = pin._color.y;
+                    value._color[2] = pin._color.z;
+                    break;
+                case PinType::TEXTURE: break;
+            }
+            values.push_back(value);
+            file_node.n_values += 1;
+        }
+        nodes.push_back(file_node);
+    }
+
+    for (int id : get_sorted_ids(graph.links)) {
+        Link &link = graph.links[id];
+        Pin *start_pin = graph.pins[link.start_pin_id];
+        Pin *end_pin = graph.pins[link.end_pin_id];
+        auto start_node = graph.nodes[start_pin->node_id];
+        auto end_node = graph.nodes[end_pin->node_id];
+        links.push_back(
+            {.start_node = (uint32_t)start_node->id,
+             .start_pin = (uint32_t)get_pin_idx(start_node, start_pin->id),
+             .end_node = (uint32_t)end_node->id,
+             .end_pin = (uint32_t)get_pin_idx(end_node, end_pin->id)}
+        );
+    }
+
+    // strings are the last section, padded to keep the file size aligned
+    strings.resize((strings.size() + 3) / 4 * 4, '\0');
+
+    GraphFileHeader header = {
+        .magic = {},
+        .version = GRAPH_FILE_VERSION,
+        .n_nodes = (uint32_t)nodes.size(),
+        .n_values = (uint32_t)values.size(),
+        .n_links = (uint32_t)links.size(),
+        .strings_size = (uint32_t)strings.size()};
+    std::memcpy(header.magic, GRAPH_FILE_MAGIC, sizeof(header.magic));
+
+    std::ofstream file(file_name, std::ios::binary);
+    file.write((const char *)&header, sizeof(header));
+    file.write((const char *)nodes.data(), nodes.size() * sizeof(GraphFileNode));
+    file.write((const char *)values.data(), values.size() * sizeof(GraphFileValue));
+    file.write((const char *)links.data(), links.size() * sizeof(GraphFileLink));
+    file.write(strings.data(), strings.size());
+    if (!file) throw std::runtime_error("Failed to save graph to " + file_name);
+}
+
+// read-only mapping of a whole file, unmapped by the destructor
+class MappedFile {
+public:
+    const char *data;
+    size_t size;
+
+    MappedFile(const std::string &file_name)
+        : data(nullptr)
+        , size(0) {
+        int fd = open(file_name.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd == -1 || fstat(fd, &st) == -1) {
+            if (fd != -1) close(fd);
+            throw std::runtime_error("Failed to open " + file_name);
+        }
+
+        size = st.st_size;
+        void *ptr = size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+        close(fd);
+        if (ptr == MAP_FAILED) throw std::runtime_error("Failed to map " + file_name);
+        data = (const char *)ptr;
+    }
+
+    ~MappedFile() {
+        if (data) munmap((void *)data, size);
+    }
+};
+
+static void load_binary(Graph &graph, const std::string &file_name) {
+    MappedFile file(file_name);
+    auto error = std::runtime_error("Invalid graph file " + file_name);
+
+    auto header = (const GraphFileHeader *)file.data;
+    if (file.size < sizeof(GraphFileHeader)
+        || std::memcmp(header->magic, GRAPH_FILE_MAGIC, sizeof(header->magic)) != 0
+        || header->version != GRAPH_FILE_VERSION) {
+        throw error;
+    }
+
+    size_t nodes_size = (size_t)header->n_nodes * sizeof(GraphFileNode);
+    size_t values_size = (size_t)header->n_values * sizeof(GraphFileValue);
+    size_t links_size = (size_t)header->n_links * sizeof(GraphFileLink);
+    size_t size = sizeof(GraphFileHeader) + nodes_size + values_size + links_size
+                  + header->strings_size;
+    if (file.size != size || header->strings_size == 0) throw error;
+
+    auto nodes = (const GraphFileNode *)(header + 1);
+    auto values = (const GraphFileValue *)(nodes + header->n_nodes);
+    auto links = (const GraphFileLink *)(values + header->n_values);
+    auto strings = (const char *)(links + header->n_links);
+    if (strings[header->strings_size - 1] != '\0') throw error;
+
+    auto get_string = [&](uint32_t offset) {
+        if (offset >= header->strings_size) throw error;
+        return std::string(strings + offset);
+    };
+
+    graph.nodes.reserve(header->n_nodes);
+    graph.links.reserve(header->n_links);
+
+    uint32_t max_node_id = 0;
+    std::unordered_set<uint32_t> node_ids;
+    for (uint32_t i = 0; i < header->n_nodes; ++i) {
+        if (nodes[i].id == 0 || !node_ids.insert(nodes[i].id).second) throw error;
+        max_node_id = std::max(max_node_id, nodes[i].id);
+    }
+    if (max_node_id > INT32_MAX / 2) throw error;
+    reserve_ids(max_node_id);
+
+    for (uint32_t i = 0; i < header->n_nodes; ++i) {
+        const GraphFileNode &file_node = nodes[i];
+        auto node = graph.create_node_by_name(
+            get_string(file_node.name), get_string(file_node.file_name)
+        );
+        node->preview = file_node.preview;
+
+        if ((size_t)file_node.first_value + file_node.n_values > header->n_values) {
+            throw error;
+        }
+        for (uint32_t j = 0; j < file_node.n_values; ++j) {
+            const GraphFileValue &value = values[file_node.first_value + j];
+            if (value.pin >= node->pins.size()) throw error;
+            Pin &pin = node->pins[value.pin];
+            if ((uint32_t)pin.type != value.type) throw error;
+
+            switch (pin.type) {
+                case PinType::INT: set_loaded_value(pin, value._int); break;
+                case PinType::FLOAT: set_loaded_value(pin, value._float); break;
+                case PinType::BOOL: pin._bool = value._bool; break;
+                case PinType::COLOR:
+                    pin._color = {value._color[0], value._color[1], value._color[2]};
+                    break;
+                case PinType::TEXTURE: break;
+            }
+        }
+
+        graph.create_node(node, file_node.id);
+    }
+
+    for (uint32_t i = 0; i < header->n_links; ++i) {
+        const GraphFileLink &link = links[i];
+        auto start_node = graph.nodes.at(link.start_node);
+        auto end_node = graph.nodes.at(link.end_node);
+        if (link.start_pin >= start_node->pins.size()
+            || link.end_pin >= end_node->pins.size()) {
+            throw error;
+        }
+        Link graph_link(
+            start_node->pins[link.start_pin].id, end_node->pins[link.end_pin].id
+        );
+        if (!graph.can_create_link(graph_link)) throw error;
+        graph.create_link(graph_link);
+    }
+}
+
+void Graph::save(const std::string &file_name) {
+    // renamed once complete, a failed save keeps the old file
+    std::string tmp_file_name = file_name + ".tmp";
+    if (ends_with(file_name, ".json")) {
+        save_json(*this, tmp_file_name);
+    } else {
+        save_binary(*this, tmp_file_name);
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tmp_file_name, file_name, error);
+    if (error) throw std::runtime_error("Failed to save graph to " + file_name);
+}
+
+void Graph::load(const std::string &file_name) {
+    // loaded into a new graph and moved over once complete, a bad file
+    // keeps the current nodes
+    Graph graph;
+    if (ends_with(file_name, ".json")) {
+        load_json(graph, file_name);
+    } else {
+        load_binary(graph, file_name);
+    }
+
+    clear();
+    this->pins = std::move(graph.pins);
+    this->nodes = std::move(graph.nodes);
+    this->links = std::move(graph.links);
+    this->is_dirty = true;
+}
@@ -1,4 +1,6 @@
 #pragma once
+#include "latency.hpp"
+#include "profiler.hpp"
 #include "raylib/raylib.h"
 #include <functional>
 #include <memory>
@@ -9,10 +11,15 @@
 class Pin;
 class Node;
 class Link;
+class CpuKernel;
+class CpuBackend;
+class FusedPass;
+class Thumbnail;
 
 enum class PinType {
     INT,
     FLOAT,
+    BOOL,
     COLOR,
     TEXTURE,
 };
@@ -44,23 +51,64 @@ public:
             float max;
         } _float;
 
+        bool _bool;
         Vector3 _color;
         Texture _texture;
     };
+    // of the frame in _texture, the outputs take the stamp of the input pin
+    FrameStamp stamp;
 
     Pin();
     static Pin create_int(PinKind kind, std::string name, int val, int min, int max);
     static Pin create_float(
         PinKind kind, std::string name, float val, float min, float max
     );
+    static Pin create_bool(PinKind kind, std::string name, bool val);
     static Pin create_color(PinKind kind, std::string name, Vector3 val);
     static Pin create_texture(PinKind kind, std::string name);
 };
 
+Pin &get_pin(std::vector<Pin> &pins, const std::string &name);
+
+// a length in full resolution pixels at 1 / proxy_scale of the resolution,
+// at least a pixel
+int get_proxy_pixels(int pixels, int proxy_scale);
+
 class NodeContext {
 public:
+    // sources emit frames downscaled by proxy_scale, set by the graph, the
+    // pins in pixels are scaled with get_proxy_pixels()
+    int proxy_scale;
+
+    NodeContext()
+        : proxy_scale(1) {}
     virtual ~NodeContext() {}
     virtual void update(std::shared_ptr<Node>) = 0;
+
+    // nodes without a cpu kernel fall back to the gpu on the cpu backend
+    virtual CpuKernel *get_cpu_kernel() {
+        return nullptr;
+    }
+
+    // sources of finite streams are finished after their last frame
+    virtual bool is_finished() {
+        return false;
+    }
+
+    // frames per second of a file source, 0 for the other nodes
+    virtual double get_fps() {
+        return 0.0;
+    }
+
+    // returns the output render targets to the pool, called by the graph
+    // once the last consumer of the output has run
+    virtual void release_targets() {}
+
+    // whether the output is the input texture itself, its consumers then
+    // extend the lifetime of the input
+    virtual bool forwards_input() {
+        return false;
+    }
 };
 
 class Node {
@@ -68,6 +116,11 @@ public:
     int id;
     std::string name;
     std::vector<Pin> pins;
+    bool preview;
+    // set for a single update when the preview is redrawn from the output,
+    // the output is then materialized and kept until the end of the update,
+    // unlike preview it never recompiles the graph
+    bool is_preview_due;
 
     NodeContext *context;
 
@@ -96,6 +149,30 @@ public:
 enum class PinType;
 enum class PinKind;
 
+std::shared_ptr<Node> create_video_file_node(std::string file_name);
+// records to file_name, freska.avi if it's empty
+std::shared_ptr<Node> create_video_writer_node(std::string file_name);
+
+// gl functions must not be called without a context, e.g. in the headless
+// runner on the cpu backend
+bool is_gl_ready();
+// called before the context is destroyed, the graphs must release their gl
+// resources before, is_gl_ready() is false afterwards
+void set_gl_closed();
+
+// rebuilds the shaders which use the files of shaders/ in the background, they
+// are swapped in by Graph::update() once all of them compile
+void reload_shaders(const std::vector<std::string> &file_names);
+
+// the gpu backend runs the wide gathers of Color Quantization and Color
+// Outline as compute shaders where the driver supports them, on by default
+void set_compute_enabled(bool is_enabled);
+
+enum class Backend {
+    GPU,
+    CPU,
+};
+
 class Graph {
 public:
     std::unordered_map<int, Pin *> pins;
@@ -103,6 +180,32 @@ public:
     std::unordered_map<int, Link> links;
     std::vector<NodeFactory> node_factories;
 
+    Backend backend;
+    std::shared_ptr<CpuBackend> cpu_backend;
+
+    // 1, 2 or 4: the whole graph runs at 1 / proxy_scale of the source
+    // resolution for faster editing, 1 is the full resolution
+    int proxy_scale;
+
+    // incremented by update(), offsets the noise of the nodes with temporal
+    // noise on, it's per graph so that a file of a batch comes out the same
+    // whatever the other workers do
+    int frame_idx;
+
+    // topologically sorted node ids, rebuilt by compile() when is_dirty is set
+    std::vector<int> order;
+    // by order index: the nodes whose outputs are released after that node
+    std::vector<std::vector<int>> releases;
+    // by node id: the pass drawing the node with the rest of its run, drawn
+    // in place of the last node of the run, the others aren't updated
+    std::unordered_map<int, std::shared_ptr<FusedPass>> fused_passes;
+    bool is_dirty;
+
+    // node timings of update(), a fused run is timed as its last node
+    Profiler profiler;
+    // the graph only stamps the frames, the outputs record them
+    LatencyStats latency;
+
     Graph();
 
     void delete_node(int node_id);
@@ -111,7 +214,63 @@ public:
     bool can_create_link(Link link);
 
     int create_link(Link link);
-    int create_node(std::shared_ptr<Node> node);
+    // a new id if id is 0, loaded nodes keep theirs to match the editor layout
+    int create_node(std::shared_ptr<Node> node, int id = 0);
+    // a node of the factory, file_name is passed to the Video File and Video
+    // Writer nodes
+    std::shared_ptr<Node> create_node_by_name(
+        const std::string &name, const std::string &file_name = ""
+    );
+    void clear();
+
+    void transfer_links(std::shared_ptr<Node> node);
+    std::shared_ptr<Node> get_input_node(std::shared_ptr<Node> node);
+    int get_n_consumers(std::shared_ptr<Node> node);
 
+    void compile();
     void update();
+    // seconds of the animated shaders, frame_idx over the fps of the file
+    // sources, so that a file renders the same at any speed
+    float get_time();
+
+    // JSON if the file name ends with .json, otherwise the memory-mappable
+    // binary format, both throw on errors
+    void save(const std::string &file_name);
+    void load(const std::string &file_name);
+};
+
+// Box filtered copies of the node outputs at about the preview size, so the
+// editor doesn't sample whole frames. A thumbnail is redrawn at most
+// refresh_rate times a second, right after the graph update, and unloaded
+// once it isn't requested for a while, e.g. while its node is off the screen.
+// Between the redraws the graph fuses and releases the outputs as if there
+// were no previews.
+class Thumbnails {
+private:
+    // by pin id
+    std::unordered_map<int, std::shared_ptr<Thumbnail>> thumbnails;
+    std::vector<FrameStamp> stamps;
+
+public:
+    float refresh_rate;
+
+    Thumbnails();
+
+    // the last drawn thumbnail of the pin, not ready until the first draw,
+    // width is the preview width. Requests a redraw from the next graph
+    // update once the thumbnail is older than 1 / refresh_rate.
+    Texture get(const Pin &pin, int width);
+    // the last drawn thumbnail without a request, e.g. of a culled preview
+    Texture find(int pin_id);
+
+    // called before the graph update, marks the nodes of the requested
+    // redraws as is_preview_due
+    void prepare(Graph &graph);
+    // called after the graph update, redraws the requested thumbnails and
+    // unloads the ones which weren't requested for a while
+    void update(Graph &graph);
+
+    // stamps of the frames redrawn since the last call, they reach the
+    // screen with the next buffer swap
+    std::vector<FrameStamp> take_stamps();
 };
@@ -0,0 +1,92 @@
+#include "latency.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// a power of two is split into SUB_BUCKETS / 2 buckets
+static const int SUB_BUCKET_BITS = 6;
+static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+// about 71 minutes in us
+static const uint64_t MAX_US = (1ull << 32) - 1;
+static const int N_BUCKETS = (32 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS / 2
+                             + SUB_BUCKETS / 2;
+
+int64_t get_stamp_ns() {
+    auto time = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time).count();
+}
+
+FrameStamp::FrameStamp()
+    : grab_ns(0)
+    , pickup_ns(0)
+    , done_ns(0) {}
+
+// the values of a bucket share their top SUB_BUCKET_BITS bits
+static int get_bucket(uint64_t us) {
+    int msb = us ? 63 - __builtin_clzll(us) : 0;
+    int shift = std::max(0, msb - SUB_BUCKET_BITS + 1);
+    return shift * SUB_BUCKETS / 2 + (int)(us >> shift);
+}
+
+// the middle of the bucket values
+static double get_bucket_us(int bucket) {
+    int shift = std::max(0, bucket / (SUB_BUCKETS / 2) - 1);
+    uint64_t min_us = (uint64_t)(bucket - shift * SUB_BUCKETS / 2) << shift;
+    return min_us + ((1ull << shift) - 1) / 2.0;
+}
+
+// -----------------------------------------------------------------------
+// histogram
+LatencyHistogram::LatencyHistogram()
+    : counts(N_BUCKETS, 0)
+    , n_values(0) {}
+
+void LatencyHistogram::record(int64_t ns) {
+    uint64_t us = std::min((uint64_t)std::max<int64_t>(0, ns / 1000), MAX_US);
+    this->counts[get_bucket(us)] += 1;
+    this->n_values += 1;
+}
+
+double LatencyHistogram::get_percentile_ms(double p) {
+    if (this->n_values == 0) return 0.0;
+
+    uint64_t rank = std::max<uint64_t>(1, std::ceil(p * this->n_values));
+    uint64_t n = 0;
+    for (int bucket = 0; bucket < N_BUCKETS; ++bucket) {
+        n += this->counts[bucket];
+        if (n >= rank) return get_bucket_us(bucket) / 1000.0;
+    }
+    return MAX_US / 1000.0;
+}
+
+void LatencyHistogram::clear() {
+    std::fill(this->counts.begin(), this->counts.end(), 0);
+    this->n_values = 0;
+}
+
+// -----------------------------------------------------------------------
+// stats
+LatencyStats::LatencyStats()
+    : last_grab_ns(0) {}
+
+void LatencyStats::record(const FrameStamp &stamp, int64_t output_ns) {
+    if (stamp.grab_ns == 0 || stamp.grab_ns <= this->last_grab_ns) return;
+    this->last_grab_ns = stamp.grab_ns;
+
+    this->total.record(output_ns - stamp.grab_ns);
+    // a frame which skipped a stage still counts in the total
+    if (stamp.pickup_ns) this->capture.record(stamp.pickup_ns - stamp.grab_ns);
+    if (stamp.pickup_ns && stamp.done_ns) {
+        this->graph.record(stamp.done_ns - stamp.pickup_ns);
+    }
+    if (stamp.done_ns) this->output.record(output_ns - stamp.done_ns);
+}
+
+void LatencyStats::clear() {
+    this->last_grab_ns = 0;
+    this->capture.clear();
+    this->graph.clear();
+    this->output.clear();
+    this->total.clear();
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// steady_clock time in ns, the clock of the frame stamps
+int64_t get_stamp_ns();
+
+// Times of a frame on its way through the graph, 0 if not reached (or the
+// frame isn't from a source). Texture pins carry the stamp of their frame.
+class FrameStamp {
+public:
+    // the capture returned the frame
+    int64_t grab_ns;
+    // the source handed it to the graph (uploaded it on the gpu backend)
+    int64_t pickup_ns;
+    // the graph update which produced the output ended
+    int64_t done_ns;
+
+    FrameStamp();
+};
+
+// Log-linear buckets like HdrHistogram: values below 64 us get a bucket
+// each, above that every power of two is split into 32 buckets, so a
+// percentile is within about 3% of the recorded value. Recording is a
+// couple of integer ops and the memory is fixed, values over an hour are
+// clamped.
+class LatencyHistogram {
+private:
+    std::vector<uint64_t> counts;
+
+public:
+    uint64_t n_values;
+
+    LatencyHistogram();
+
+    void record(int64_t ns);
+    // p in [0, 1], 0 if nothing is recorded
+    double get_percentile_ms(double p);
+    void clear();
+};
+
+// End-to-end and per-stage latency of the frames reaching the screen or a
+// sink. A frame is recorded once, when it arrives first, a live source
+// frame the graph processes again while waiting for the next one isn't
+// counted again.
+class LatencyStats {
+private:
+    int64_t last_grab_ns;
+
+public:
+    // grab -> pickup -> done -> output, and grab -> output
+    LatencyHistogram capture;
+    LatencyHistogram graph;
+    LatencyHistogram output;
+    LatencyHistogram total;
+
+    LatencyStats();
+
+    // output_ns is when the frame reached the screen or the sink
+    void record(const FrameStamp &stamp, int64_t output_ns);
+    void clear();
+};
@@ -0,0 +1,146 @@
+#include "noise.hpp"
+
+#include "raylib/raylib.h"
+#include "raylib/rlgl.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Void-and-cluster (Ulichney 1993) on a torus. The energy of a pixel is the sum
+// of a gaussian over the set pixels, so the tightest cluster is the set pixel
+// with the max energy and the largest void is the unset pixel with the min one.
+class VoidAndCluster {
+private:
+    static const int SIZE = BlueNoise::SIZE;
+    static const int N = SIZE * SIZE;
+
+    std::vector<float> gaussian;
+    std::vector<float> energy;
+
+public:
+    std::vector<bool> is_set;
+
+    VoidAndCluster()
+        : gaussian(N)
+        , energy(N, 0.0f)
+        , is_set(N, false) {
+        const float sigma = 1.5f;
+        for (int y = 0; y < SIZE; ++y) {
+            for (int x = 0; x < SIZE; ++x) {
+                // wrapped distance
+                int dx = std::min(x, SIZE - x);
+                int dy = std::min(y, SIZE - y);
+                float d2 = dx * dx + dy * dy;
+                gaussian[y * SIZE + x] = std::exp(-d2 / (2.0f * sigma * sigma));
+            }
+        }
+    }
+
+    void toggle(int idx) {
+        is_set[idx] = !is_set[idx];
+        float sign = is_set[idx] ? 1.0f : -1.0f;
+        int x0 = idx % SIZE;
+        int y0 = idx / SIZE;
+        for (int y = 0; y < SIZE; ++y) {
+            const float *row = &gaussian[((y - y0 + SIZE) % SIZE) * SIZE];
+            float *energy_row = &energy[y * SIZE];
+            // the row is wrapped at x0
+            for (int x = 0; x < x0; ++x) {
+                energy_row[x] += sign * row[x - x0 + SIZE];
+            }
+            for (int x = x0; x < SIZE; ++x) {
+                energy_row[x] += sign * row[x - x0];
+            }
+        }
+    }
+
+    int find_tightest_cluster() {
+        int best = -1;
+        for (int i = 0; i < N; ++i) {
+            if (is_set[i] && (best == -1 || energy[i] > energy[best])) best = i;
+        }
+        return best;
+    }
+
+    int find_largest_void() {
+        int best = -1;
+        for (int i = 0; i < N; ++i) {
+            if (!is_set[i] && (best == -1 || energy[i] < energy[best])) best = i;
+        }
+        return best;
+    }
+};
+
+BlueNoise::BlueNoise()
+    : values(SIZE * SIZE) {
+    const int n = SIZE * SIZE;
+    VoidAndCluster vc;
+
+    // initial pattern: 10% random pixels, fixed seed so the mask is the same
+    // on every run, then relaxed by moving the tightest cluster into the
+    // largest void until it's the same pixel
+    std::mt19937 rng(1);
+    int n_initial = n / 10;
+    for (int i = 0; i < n_initial;) {
+        int idx = rng() % n;
+        if (vc.is_set[idx]) continue;
+        vc.toggle(idx);
+        ++i;
+    }
+    while (true) {
+        int cluster = vc.find_tightest_cluster();
+        vc.toggle(cluster);
+        int void_ = vc.find_largest_void();
+        if (void_ == cluster) {
+            vc.toggle(cluster);
+            break;
+        }
+        vc.toggle(void_);
+    }
+    std::vector<bool> initial = vc.is_set;
+
+    // ranks of the initial pixels: remove the tightest clusters
+    std::vector<int> ranks(n);
+    for (int rank = n_initial - 1; rank >= 0; --rank) {
+        int cluster = vc.find_tightest_cluster();
+        ranks[cluster] = rank;
+        vc.toggle(cluster);
+    }
+
+    // ranks of the rest: fill the largest voids, it's the same as removing
+    // the tightest clusters of the unset pixels in the second half
+    for (int i = 0; i < n; ++i) {
+        if (initial[i]) vc.toggle(i);
+    }
+    for (int rank = n_initial; rank < n; ++rank) {
+        int void_ = vc.find_largest_void();
+        ranks[void_] = rank;
+        vc.toggle(void_);
+    }
+
+    for (int i = 0; i < n; ++i) {
+        values[i] = (ranks[i] + 0.5f) / n;
+    }
+    texture.id = 0;
+}
+
+Texture BlueNoise::get_texture() {
+    if (texture.id == 0) {
+        texture = {
+            .id = rlLoadTexture(
+                values.data(), SIZE, SIZE, RL_PIXELFORMAT_UNCOMPRESSED_R32, 1
+            ),
+            .width = SIZE,
+            .height = SIZE,
+            .mipmaps = 1,
+            .format = RL_PIXELFORMAT_UNCOMPRESSED_R32};
+    }
+    return texture;
+}
+
+// built on the first use, the texture lives until the gl context is destroyed
+BlueNoise &get_blue_noise() {
+    static BlueNoise blue_noise;
+    return blue_noise;
+}
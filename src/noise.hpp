@@ -0,0 +1,31 @@
+#pragma once
+#include "raylib/raylib.h"
+#include <vector>
+
+// Tiled blue noise shared by the gpu and cpu backends. It's a void-and-cluster
+// rank mask: values are in [0, 1) and neighbouring pixels get values far
+// apart, so the sampling error of the stochastic nodes is high frequency and
+// far less visible than with a white noise hash.
+class BlueNoise {
+private:
+    Texture texture;
+
+public:
+    static const int SIZE = 64;
+
+    std::vector<float> values;
+
+    BlueNoise();
+
+    // the noise at pixel (x, y), with the golden ratio offset of noise_frame,
+    // so the values are also well distributed in time
+    inline float get(int x, int y, int noise_frame) const {
+        float value = values[(y % SIZE) * SIZE + x % SIZE] + noise_frame * 0.618034f;
+        return value - (int)value;
+    }
+
+    // R32 texture, uploaded on the first call
+    Texture get_texture();
+};
+
+BlueNoise &get_blue_noise();
@@ -0,0 +1,109 @@
+#include "offscreen.hpp"
+
+#include "EGL/egl.h"
+#include "EGL/eglext.h"
+#include "graph.hpp"
+#include "raylib/rlgl.h"
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+static bool has_extension(EGLDisplay display, const char *name) {
+    const char *extensions = eglQueryString(display, EGL_EXTENSIONS);
+    return extensions && std::strstr(extensions, name);
+}
+
+static EGLDisplay get_display() {
+    // the surfaceless platform doesn't need a display server
+    auto get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+        "eglGetPlatformDisplayEXT"
+    );
+    if (get_platform_display
+        && has_extension(EGL_NO_DISPLAY, "EGL_MESA_platform_surfaceless")) {
+        EGLDisplay display = get_platform_display(
+            EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr
+        );
+        if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr)) {
+            return display;
+        }
+    }
+
+    EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+        throw std::runtime_error("Failed to initialize EGL display");
+    }
+    return display;
+}
+
+OffscreenContext::OffscreenContext()
+    : display(EGL_NO_DISPLAY)
+    , context(EGL_NO_CONTEXT)
+    , surface(EGL_NO_SURFACE) {
+    display = get_display();
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        throw std::runtime_error("Failed to bind OpenGL API");
+    }
+
+    const EGLint config_attribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_ALPHA_SIZE, 8,
+        EGL_NONE,
+    };
+    EGLConfig config;
+    EGLint n_configs = 0;
+    eglChooseConfig(display, config_attribs, &config, 1, &n_configs);
+    if (n_configs == 0) {
+        // the surfaceless platform might have no pbuffer configs
+        const EGLint any_attribs[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+        eglChooseConfig(display, any_attribs, &config, 1, &n_configs);
+    }
+    if (n_configs == 0) throw std::runtime_error("Failed to choose EGL config");
+
+    // same as the window context of raylib
+    const EGLint context_attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE,
+    };
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+    if (context == EGL_NO_CONTEXT) {
+        throw std::runtime_error("Failed to create EGL context");
+    }
+
+    // all the rendering goes to the render textures, so a surface is only
+    // needed without EGL_KHR_surfaceless_context
+    if (!has_extension(display, "EGL_KHR_surfaceless_context")) {
+        const EGLint surface_attribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+        surface = eglCreatePbufferSurface(display, config, surface_attribs);
+        if (surface == EGL_NO_SURFACE) {
+            throw std::runtime_error("Failed to create EGL pbuffer surface");
+        }
+    }
+
+    if (!eglMakeCurrent(display, surface, surface, context)) {
+        throw std::runtime_error("Failed to make EGL context current");
+    }
+
+    rlLoadExtensions((void *)eglGetProcAddress);
+    rlglInit(1, 1);
+    rlDisableBackfaceCulling();
+}
+
+OffscreenContext::~OffscreenContext() {
+    set_gl_closed();
+    rlglClose();
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (surface != EGL_NO_SURFACE) eglDestroySurface(display, surface);
+    eglDestroyContext(display, context);
+    eglTerminate(display);
+}
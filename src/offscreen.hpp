@@ -0,0 +1,17 @@
+#pragma once
+
+// Offscreen gl context for running the shader nodes without a window or a
+// display server: EGL on Mesa's surfaceless platform, or on the default
+// display with a pbuffer surface. Works with llvmpipe, so there is no need
+// for a gpu either. Replaces InitWindow(): rlgl is initialized on the context.
+class OffscreenContext {
+private:
+    // EGLDisplay, EGLContext and EGLSurface
+    void *display;
+    void *context;
+    void *surface;
+
+public:
+    OffscreenContext();
+    ~OffscreenContext();
+};
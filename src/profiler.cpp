@@ -0,0 +1,100 @@
+#include "profiler.hpp"
+
+#include "gl.hpp"
+#include "graph.hpp"
+
+static const double SMOOTHING_FRAMES = 30.0;
+
+// frames of queries in flight, the drivers report them a frame or two later
+static const size_t MAX_PENDING_FRAMES = 4;
+
+NodeTiming::NodeTiming()
+    : cpu_ms(0.0)
+    , gpu_ms(0.0)
+    , total_cpu_ms(0.0)
+    , total_gpu_ms(0.0)
+    , n_cpu_frames(0)
+    , n_gpu_frames(0) {}
+
+Profiler::Profiler()
+    : node_id(-1)
+    , is_gpu_frame(false)
+    , is_enabled(false) {}
+
+void Profiler::add_sample(double &smoothed, double &total, int &n, double ms) {
+    // the first sample starts the average, otherwise it would take a while
+    // to climb from 0
+    smoothed = n == 0 ? ms : smoothed + (ms - smoothed) / SMOOTHING_FRAMES;
+    total += ms;
+    n += 1;
+}
+
+void Profiler::begin(int node_id) {
+    if (!this->is_enabled) return;
+    this->node_id = node_id;
+
+    if (this->is_gpu_frame) {
+        unsigned int query;
+        if (this->free_queries.empty()) {
+            glGenQueries(1, &query);
+        } else {
+            query = this->free_queries.back();
+            this->free_queries.pop_back();
+        }
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        this->queries.push_back({.node_id = node_id, .query = query});
+    }
+    this->start = std::chrono::steady_clock::now();
+}
+
+void Profiler::end() {
+    if (!this->is_enabled || this->node_id == -1) return;
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now()
+                                                        - this->start;
+    NodeTiming &timing = this->timings[this->node_id];
+    add_sample(timing.cpu_ms, timing.total_cpu_ms, timing.n_cpu_frames, elapsed.count());
+
+    if (this->is_gpu_frame) glEndQuery(GL_TIME_ELAPSED);
+    this->node_id = -1;
+}
+
+// the queries of a frame finish in order, so the last one tells about all
+void Profiler::read_queries() {
+    while (!this->pending_queries.empty()) {
+        auto &queries = this->pending_queries.front();
+        GLint is_available = 0;
+        GLuint last = queries.back().query;
+        glGetQueryObjectiv(last, GL_QUERY_RESULT_AVAILABLE, &is_available);
+        if (!is_available) return;
+
+        for (auto &query : queries) {
+            GLuint64 ns = 0;
+            glGetQueryObjectui64v(query.query, GL_QUERY_RESULT, &ns);
+            this->free_queries.push_back(query.query);
+
+            // the node might be deleted meanwhile
+            auto it = this->timings.find(query.node_id);
+            if (it == this->timings.end()) continue;
+            NodeTiming &timing = it->second;
+            add_sample(timing.gpu_ms, timing.total_gpu_ms, timing.n_gpu_frames, ns / 1e6);
+        }
+        this->pending_queries.pop_front();
+    }
+}
+
+void Profiler::end_frame() {
+    if (!is_gl_ready()) return;
+
+    if (!this->queries.empty()) {
+        this->pending_queries.push_back(std::move(this->queries));
+        this->queries.clear();
+    }
+    read_queries();
+    this->is_gpu_frame = this->is_enabled
+                         && this->pending_queries.size() < MAX_PENDING_FRAMES;
+}
+
+void Profiler::clear() {
+    this->timings.clear();
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <chrono>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+class NodeTiming {
+public:
+    // smoothed over about the last SMOOTHING_FRAMES frames, for the editor
+    double cpu_ms;
+    double gpu_ms;
+
+    // sums over all the measured frames, for the averages of a whole run
+    double total_cpu_ms;
+    double total_gpu_ms;
+    int n_cpu_frames;
+    // 0 without a gl context
+    int n_gpu_frames;
+
+    NodeTiming();
+};
+
+// Per node timings of the graph updates. The cpu time of a node is taken with
+// steady_clock around its update and the gpu time with a GL_TIME_ELAPSED
+// query around the same commands. The queries are read a few frames later,
+// so the cpu never waits for them, the frames are measured on the cpu only
+// while too many of them are pending. The queries live until the gl context
+// is destroyed.
+class Profiler {
+private:
+    class Query {
+    public:
+        int node_id;
+        unsigned int query;
+    };
+
+    // by frame, the oldest first
+    std::deque<std::vector<Query>> pending_queries;
+    std::vector<Query> queries;
+    std::vector<unsigned int> free_queries;
+
+    int node_id;
+    std::chrono::steady_clock::time_point start;
+    bool is_gpu_frame;
+
+    void add_sample(double &smoothed, double &total, int &n, double ms);
+    void read_queries();
+
+public:
+    // off by default, begin() and end() do nothing then
+    bool is_enabled;
+    // by node id
+    std::unordered_map<int, NodeTiming> timings;
+
+    Profiler();
+
+    // times the work of the node until end(), the calls don't nest
+    void begin(int node_id);
+    void end();
+
+    // called once per frame after the nodes are updated
+    void end_frame();
+
+    // drops the timings, e.g. before the next file of a batch
+    void clear();
+};
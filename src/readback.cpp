@@ -0,0 +1,87 @@
+#include "readback.hpp"
+
+#include "gl.hpp"
+#include "graph.hpp"
+
+Readback::Readback(int n_slots)
+    : slots(n_slots, {.buffer = 0, .fence = nullptr, .width = 0, .height = 0, .size = 0})
+    , head(0)
+    , n_pending(0)
+    , framebuffer(0) {}
+
+Readback::~Readback() {
+    if (!is_gl_ready()) return;
+    for (auto &slot : this->slots) {
+        if (slot.fence) glDeleteSync((GLsync)slot.fence);
+        if (slot.buffer) glDeleteBuffers(1, &slot.buffer);
+    }
+    if (this->framebuffer) glDeleteFramebuffers(1, &this->framebuffer);
+}
+
+bool Readback::read(Texture texture) {
+    if (this->n_pending == (int)this->slots.size()) return false;
+    Slot &slot = this->slots[(this->head + this->n_pending) % this->slots.size()];
+
+    size_t size = (size_t)texture.width * texture.height * 4;
+    if (slot.buffer == 0) glGenBuffers(1, &slot.buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    if (slot.size != size) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        slot.size = size;
+    }
+
+    // the copy into the bound pack buffer returns without waiting
+    if (this->framebuffer == 0) glGenFramebuffers(1, &this->framebuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, this->framebuffer);
+    glFramebufferTexture2D(
+        GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture.id, 0
+    );
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glReadPixels(0, 0, texture.width, texture.height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.width = texture.width;
+    slot.height = texture.height;
+    this->n_pending += 1;
+    return true;
+}
+
+bool Readback::poll(
+    const std::function<void(const unsigned char *rgba, int width, int height)> &fn,
+    bool wait
+) {
+    if (this->n_pending == 0) return false;
+    Slot &slot = this->slots[this->head];
+
+    // the flush makes sure the fence gets to the gpu, otherwise it might
+    // never be signaled
+    GLuint64 timeout = wait ? 1000000000ull : 0;
+    GLenum status = glClientWaitSync(
+        (GLsync)slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout
+    );
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+        return false;
+    }
+    glDeleteSync((GLsync)slot.fence);
+    slot.fence = nullptr;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    auto data = (const unsigned char *)glMapBufferRange(
+        GL_PIXEL_PACK_BUFFER, 0, slot.size, GL_MAP_READ_BIT
+    );
+    // the callers keep a queue parallel to the slots, so a lost frame is
+    // still reported
+    fn(data, slot.width, slot.height);
+    if (data) glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    this->head = (this->head + 1) % this->slots.size();
+    this->n_pending -= 1;
+    return true;
+}
+
+int Readback::get_n_pending() {
+    return this->n_pending;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "raylib/raylib.h"
+#include <functional>
+#include <vector>
+
+// Asynchronous texture readback. read() copies the texture into the next
+// pixel buffer of a ring and puts a fence after the copy, poll() hands the
+// oldest frame back once its fence is signaled, usually one or two frames
+// later, so the cpu never waits for the gpu to drain its queue like it does
+// with a plain glReadPixels. The gl resources are created on the first read.
+class Readback {
+private:
+    class Slot {
+    public:
+        unsigned int buffer;
+        // GLsync of the copy
+        void *fence;
+        int width;
+        int height;
+        size_t size;
+    };
+
+    std::vector<Slot> slots;
+    // the oldest pending slot and the number of pending slots
+    int head;
+    int n_pending;
+    unsigned int framebuffer;
+
+public:
+    Readback(int n_slots = 3);
+    ~Readback();
+
+    // false if all the slots are pending, the frame is skipped then
+    bool read(Texture texture);
+
+    // calls fn with the oldest frame while its buffer is mapped, rows are in
+    // texture order and pixels are RGBA u8, rgba is null if the buffer can't
+    // be mapped and the frame is lost. False if the frame isn't ready, wait
+    // blocks until it is
+    bool poll(
+        const std::function<void(const unsigned char *rgba, int width, int height)> &fn,
+        bool wait = false
+    );
+
+    int get_n_pending();
+};
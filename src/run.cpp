@@ -0,0 +1,717 @@
+#include "cpu.hpp"
+#include "graph.hpp"
+#include "imgui/crude_json.h"
+#include "offscreen.hpp"
+#include "opencv2/core.hpp"
+#include "opencv2/imgcodecs.hpp"
+#include "opencv2/imgproc.hpp"
+#include "raylib/raylib.h"
+#include "readback.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Headless graph runner: builds a chain of nodes from the command line (or
+// loads a saved graph and extends it) and runs it without a window, on the
+// cpu backend or on the gpu backend in an offscreen gl context.
+
+static const char *USAGE = R"(Usage: freska-run (-i INPUT | -G GRAPH) [options]
+
+  -i, --input FILE         video file to process, more than one runs a batch
+  -l, --list FILE          batch of video files, one per line
+  -G, --graph FILE         load a saved graph, -i replaces its video sources
+  -n, --node NAME          append a node to the chain, e.g. "Color Correction"
+  -s, --set PIN=VALUE      set a pin of the last node, colors are R,G,B
+  -o, --output PATTERN     write the frames, e.g. out/%05d.png, {} is replaced
+                           by the input name in a batch, e.g. out/{}_%05d.png
+  -f, --frames N           stop after N frames
+  -p, --proxy 1|2|4        process at 1/2 or 1/4 resolution
+  -c, --precision NAME     f32 (default), f16, u16 or u8
+  -g, --gpu                run the shaders in an offscreen gl context
+  -T, --timings            report the average cpu and gpu time of each node
+  -L, --latency            report the p50 and p99 latency from the frame read
+                           to the output, in total and by stage
+      --trace FILE         write a Chrome trace of the whole run
+  -j, --jobs N             batch workers, each with its own graph (default:
+                           one per core, one with --gpu)
+  -t, --threads N          cores shared by the workers (default: all)
+  -q, --queue N            frames a worker buffers for writing (default: 4)
+  -h, --help
+
+A batch prints one JSON object per line to stdout: "start", "progress" (each
+second), "done" or "error" for each file and a final "summary". With
+--timings and --latency the "done" objects carry the node timings and the
+latency percentiles. At most
+jobs * (graph frames + queue) frames are in memory.
+)";
+
+class Options {
+public:
+    std::vector<std::string> inputs;
+    std::string graph;
+    std::string output;
+    std::string trace;
+    std::vector<std::string> nodes;
+    // pin assignments by node index
+    std::vector<std::vector<std::string>> values;
+    int n_frames = -1;
+    int proxy_scale = 1;
+    CpuPrecision precision = CpuPrecision::F32;
+    bool is_gpu = false;
+    bool is_timed = false;
+    bool is_latency_reported = false;
+    bool is_batch = false;
+    int n_jobs = 0;
+    int n_threads = 0;
+    int queue_size = 4;
+};
+
+static std::vector<std::string> read_list(const std::string &file_name) {
+    std::ifstream file(file_name);
+    if (!file) throw std::runtime_error("Failed to open " + file_name);
+
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty()) lines.push_back(line);
+    }
+    return lines;
+}
+
+static Options parse_options(int argc, char **argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            printf("%s", USAGE);
+            exit(0);
+        }
+        if (arg == "-g" || arg == "--gpu") {
+            options.is_gpu = true;
+            continue;
+        }
+        if (arg == "-T" || arg == "--timings") {
+            options.is_timed = true;
+            continue;
+        }
+        if (arg == "-L" || arg == "--latency") {
+            options.is_latency_reported = true;
+            continue;
+        }
+        if (i + 1 >= argc) throw std::runtime_error("Missing value of " + arg);
+        std::string value = argv[++i];
+
+        if (arg == "-i" || arg == "--input") {
+            options.inputs.push_back(value);
+        } else if (arg == "-l" || arg == "--list") {
+            auto inputs = read_list(value);
+            options.inputs.insert(options.inputs.end(), inputs.begin(), inputs.end());
+            options.is_batch = true;
+        } else if (arg == "-G" || arg == "--graph") {
+            options.graph = value;
+        } else if (arg == "-n" || arg == "--node") {
+            options.nodes.push_back(value);
+            options.values.emplace_back();
+        } else if (arg == "-s" || arg == "--set") {
+            if (options.nodes.empty()) {
+                throw std::runtime_error("--set must follow a --node");
+            }
+            options.values.back().push_back(value);
+        } else if (arg == "-o" || arg == "--output") {
+            options.output = value;
+        } else if (arg == "--trace") {
+            options.trace = value;
+        } else if (arg == "-f" || arg == "--frames") {
+            options.n_frames = std::stoi(value);
+        } else if (arg == "-p" || arg == "--proxy") {
+            options.proxy_scale = std::stoi(value);
+        } else if (arg == "-c" || arg == "--precision") {
+            const char *names[] = {"f32", "f16", "u16", "u8"};
+            auto it = std::find(std::begin(names), std::end(names), value);
+            if (it == std::end(names)) {
+                throw std::runtime_error("Unknown precision " + value);
+            }
+            options.precision = (CpuPrecision)(it - std::begin(names));
+        } else if (arg == "-j" || arg == "--jobs") {
+            options.n_jobs = std::max(std::stoi(value), 1);
+        } else if (arg == "-t" || arg == "--threads") {
+            options.n_threads = std::max(std::stoi(value), 1);
+        } else if (arg == "-q" || arg == "--queue") {
+            options.queue_size = std::max(std::stoi(value), 1);
+        } else {
+            throw std::runtime_error("Unknown option " + arg);
+        }
+    }
+
+    options.is_batch = options.is_batch || options.inputs.size() > 1;
+    if (options.inputs.empty() && (options.graph.empty() || options.is_batch)) {
+        throw std::runtime_error("No input");
+    }
+    if (options.is_batch && !options.output.empty()
+        && options.output.find("{}") == std::string::npos) {
+        throw std::runtime_error("Batch output pattern must contain {}");
+    }
+
+    if (options.n_threads == 0) {
+        options.n_threads = std::max((int)std::thread::hardware_concurrency(), 1);
+    }
+    if (options.n_jobs == 0) {
+        options.n_jobs = std::min(options.n_threads, (int)options.inputs.size());
+    }
+    // the gl context is current on the main thread only
+    if (options.is_gpu) {
+        if (options.n_jobs > 1) throw std::runtime_error("--gpu runs a single job");
+        options.n_jobs = 1;
+    }
+    options.n_jobs = std::max(options.n_jobs, 1);
+    return options;
+}
+
+static void set_pin_value(std::vector<Pin> &pins, const std::string &assignment) {
+    auto eq = assignment.find('=');
+    if (eq == std::string::npos) {
+        throw std::runtime_error("Expected PIN=VALUE, got " + assignment);
+    }
+    Pin &pin = get_pin(pins, assignment.substr(0, eq));
+    std::string value = assignment.substr(eq + 1);
+
+    switch (pin.type) {
+        case PinType::INT:
+            pin._int.val = std::clamp(std::stoi(value), pin._int.min, pin._int.max);
+            break;
+        case PinType::FLOAT:
+            pin._float.val = std::clamp(std::stof(value), pin._float.min, pin._float.max);
+            break;
+        case PinType::BOOL: pin._bool = value == "1" || value == "true"; break;
+        case PinType::COLOR: {
+            Vector3 &c = pin._color;
+            if (sscanf(value.c_str(), "%f,%f,%f", &c.x, &c.y, &c.z) != 3) {
+                throw std::runtime_error("Expected R,G,B, got " + value);
+            }
+            break;
+        }
+        case PinType::TEXTURE:
+            throw std::runtime_error("Pin " + pin.name + " can't be set");
+    }
+}
+
+static bool is_source(std::shared_ptr<Node> node) {
+    return node->name == "Video Source" || node->name == "Video File";
+}
+
+// replaces the video sources of a graph with the input file, sink is updated
+// if it's one of them
+static void rebind_sources(
+    Graph &graph, const std::string &input, std::shared_ptr<Node> &sink
+) {
+    std::vector<std::shared_ptr<Node>> sources;
+    for (auto &[_, node] : graph.nodes) {
+        if (is_source(node)) sources.push_back(node);
+    }
+
+    for (auto &source : sources) {
+        std::vector<int> end_pin_ids;
+        for (int link_id : source->pins.back().link_ids) {
+            end_pin_ids.push_back(graph.links[link_id].end_pin_id);
+        }
+        graph.delete_node(source->id);
+
+        auto node = create_video_file_node(input);
+        graph.create_node(node);
+        if (sink == source) sink = node;
+        for (int end_pin_id : end_pin_ids) {
+            graph.create_link(Link(node->pins.back().id, end_pin_id));
+        }
+    }
+}
+
+// the last node without consumers in the update order
+static std::shared_ptr<Node> get_sink(Graph &graph) {
+    graph.compile();
+    for (auto it = graph.order.rbegin(); it != graph.order.rend(); ++it) {
+        auto node = graph.nodes[*it];
+        if (graph.get_n_consumers(node) == 0) return node;
+    }
+    throw std::runtime_error("Empty graph");
+}
+
+static void write_frame(const std::string &pattern, int idx, const cv::Mat &frame) {
+    char file_name[1024];
+    snprintf(file_name, sizeof(file_name), pattern.c_str(), idx);
+
+    cv::Mat rgb = frame;
+    if (frame.depth() != CV_8U) convert_frame(frame, rgb, CV_8U);
+    cv::Mat bgr;
+    cv::cvtColor(rgb, bgr, cv::COLOR_RGB2BGR);
+    if (!cv::imwrite(file_name, bgr)) {
+        throw std::runtime_error(std::string("Failed to write ") + file_name);
+    }
+}
+
+// writes the frames on its own thread, so the encoding overlaps with the
+// processing of the next frames, at most capacity frames are queued
+class FrameWriter {
+private:
+    std::string pattern;
+    size_t capacity;
+    std::deque<std::pair<int, cv::Mat>> queue;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool is_done;
+    // the first write error, the thread stops on it
+    std::string error;
+    std::thread thread;
+
+    void write_frames() {
+        set_trace_thread_name("writer");
+        while (true) {
+            std::pair<int, cv::Mat> item;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [this] { return is_done || !queue.empty(); });
+                if (queue.empty()) return;
+                item = std::move(queue.front());
+                queue.pop_front();
+            }
+            condition.notify_all();
+
+            try {
+                TraceScope scope("output", "write");
+                write_frame(pattern, item.first, item.second);
+            } catch (const std::exception &e) {
+                std::lock_guard<std::mutex> lock(mutex);
+                error = e.what();
+                queue.clear();
+                condition.notify_all();
+                return;
+            }
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            is_done = true;
+        }
+        condition.notify_all();
+        if (thread.joinable()) thread.join();
+    }
+
+public:
+    FrameWriter(const std::string &pattern, int capacity)
+        : pattern(pattern)
+        , capacity(capacity)
+        , is_done(false)
+        , thread(&FrameWriter::write_frames, this) {}
+
+    ~FrameWriter() {
+        stop();
+    }
+
+    // blocks while the queue is full, the frame must not be reused
+    void push(int idx, cv::Mat frame) {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [&] {
+            return queue.size() < capacity || !error.empty();
+        });
+        if (!error.empty()) throw std::runtime_error(error);
+        queue.emplace_back(idx, std::move(frame));
+        condition.notify_all();
+    }
+
+    // waits for the queued frames, throws the first write error
+    void finish() {
+        stop();
+        if (!error.empty()) throw std::runtime_error(error);
+    }
+};
+
+// builds the chain (or loads the graph) for the input, returns its sink
+static std::shared_ptr<Node> build_graph(
+    Graph &graph, const Options &options, const std::string &input
+) {
+    graph.backend = options.is_gpu ? Backend::GPU : Backend::CPU;
+    graph.proxy_scale = options.proxy_scale;
+    graph.cpu_backend->precision = options.precision;
+    graph.profiler.is_enabled = options.is_timed;
+
+    // the chain: input (or the graph sink) -> nodes..., only the last node
+    // is materialized
+    std::shared_ptr<Node> last;
+    if (!options.graph.empty()) {
+        graph.load(options.graph);
+        if (!input.empty()) rebind_sources(graph, input, last);
+        last = get_sink(graph);
+    } else {
+        last = create_video_file_node(input);
+        graph.create_node(last);
+    }
+    for (size_t i = 0; i < options.nodes.size(); ++i) {
+        auto node = graph.create_node_by_name(options.nodes[i]);
+        for (auto &value : options.values[i]) set_pin_value(node->pins, value);
+        graph.create_node(node);
+        graph.create_link(Link(last->pins.back().id, node->pins[0].id));
+        last = node;
+    }
+    return last;
+}
+
+class FileStats {
+public:
+    int n_frames = 0;
+    // wall time of the graph updates, readbacks and frame queueing
+    double process_ms = 0.0;
+};
+
+// runs the graph until its sources finish, on_frame gets the stats after
+// each frame
+static FileStats process_file(
+    Graph &graph,
+    std::shared_ptr<Node> sink,
+    const Options &options,
+    const std::string &output,
+    const std::function<void(const FileStats &)> &on_frame
+) {
+    std::unique_ptr<FrameWriter> writer;
+    if (!output.empty()) {
+        writer = std::make_unique<FrameWriter>(output, options.queue_size);
+    }
+
+    graph.profiler.clear();
+    graph.latency.clear();
+    FileStats stats;
+    auto is_done = [&] {
+        return options.n_frames >= 0 && stats.n_frames >= options.n_frames;
+    };
+    // the frame reaches the sink once it's queued for writing
+    auto add_frame = [&](cv::Mat frame, const FrameStamp &stamp) {
+        if (is_done()) return;
+        if (writer) writer->push(stats.n_frames, frame);
+        graph.latency.record(stamp, get_stamp_ns());
+        stats.n_frames += 1;
+        on_frame(stats);
+    };
+
+    // the gpu frames come back a frame or two later, with the stamps in the
+    // same order
+    Readback readback;
+    std::deque<FrameStamp> stamps;
+    auto add_readback = [&](const unsigned char *rgba, int width, int height) {
+        FrameStamp stamp = stamps.front();
+        stamps.pop_front();
+        if (!rgba) {
+            fprintf(stderr, "failed to map a readback, a frame is lost\n");
+            return;
+        }
+
+        cv::Mat rgb;
+        cv::cvtColor(
+            cv::Mat(height, width, CV_8UC4, (void *)rgba), rgb, cv::COLOR_RGBA2RGB
+        );
+        add_frame(rgb, stamp);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    while (!is_done()) {
+        graph.update();
+        bool is_finished = false;
+        for (auto &[_, node] : graph.nodes) {
+            is_finished = is_finished || node->context->is_finished();
+        }
+        if (is_finished) break;
+
+        TraceScope scope("output", "frame");
+        if (options.is_gpu) {
+            // a full ring waits for its oldest frame
+            Texture texture = sink->pins.back()._texture;
+            if (IsTextureReady(texture)) {
+                bool is_read = readback.read(texture);
+                if (!is_read) {
+                    readback.poll(add_readback, true);
+                    is_read = readback.read(texture);
+                }
+                // a dropped frame has no readback to pop its stamp
+                if (is_read) stamps.push_back(sink->pins.back().stamp);
+            }
+            while (readback.poll(add_readback)) {
+            }
+        } else {
+            cv::Mat frame = graph.cpu_backend->get_frame(sink->id);
+            // the backend reuses its frames
+            if (!frame.empty()) add_frame(frame.clone(), sink->pins.back().stamp);
+        }
+    }
+    while (!is_done() && readback.poll(add_readback, true)) {
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now()
+                                                        - start;
+    stats.process_ms = elapsed.count();
+
+    if (writer) writer->finish();
+    return stats;
+}
+
+// averages over the processed frames in the update order, fused nodes are
+// timed as the last node of their run, gpu_ms is only set on the gpu backend
+static crude_json::value get_timings(Graph &graph) {
+    crude_json::value timings(crude_json::type_t::array);
+    for (int id : graph.order) {
+        auto it = graph.profiler.timings.find(id);
+        if (it == graph.profiler.timings.end()) continue;
+        auto &timing = it->second;
+
+        crude_json::value node(crude_json::type_t::object);
+        node["node"] = graph.nodes[id]->name;
+        node["id"] = (crude_json::number)id;
+        node["cpu_ms"] = timing.total_cpu_ms / timing.n_cpu_frames;
+        if (timing.n_gpu_frames) {
+            node["gpu_ms"] = timing.total_gpu_ms / timing.n_gpu_frames;
+        }
+        timings.push_back(node);
+    }
+    return timings;
+}
+
+static const char *STAGE_NAMES[] = {"capture", "graph", "output", "total"};
+
+static std::vector<LatencyHistogram *> get_stages(LatencyStats &latency) {
+    return {&latency.capture, &latency.graph, &latency.output, &latency.total};
+}
+
+// milliseconds from the frame read to the output queue, the stages are read
+// -> picked up by the graph -> graph update done -> queued
+static crude_json::value get_latency(Graph &graph) {
+    crude_json::value latency(crude_json::type_t::object);
+    auto stages = get_stages(graph.latency);
+    for (size_t i = 0; i < stages.size(); ++i) {
+        crude_json::value stage(crude_json::type_t::object);
+        stage["p50_ms"] = stages[i]->get_percentile_ms(0.5);
+        stage["p99_ms"] = stages[i]->get_percentile_ms(0.99);
+        latency[STAGE_NAMES[i]] = stage;
+    }
+    return latency;
+}
+
+static int run_single(const Options &options) {
+    Graph graph;
+    std::string input = options.inputs.empty() ? "" : options.inputs[0];
+    auto sink = build_graph(graph, options, input);
+    FileStats stats = process_file(graph, sink, options, options.output, [](auto &) {});
+
+    double ms = stats.n_frames ? stats.process_ms / stats.n_frames : 0.0;
+    fprintf(
+        stderr,
+        "frames: %d, ms/frame: %.2f, fps: %.1f\n",
+        stats.n_frames,
+        ms,
+        ms > 0.0 ? 1000.0 / ms : 0.0
+    );
+
+    if (options.is_latency_reported) {
+        auto stages = get_stages(graph.latency);
+        for (size_t i = 0; i < stages.size(); ++i) {
+            fprintf(
+                stderr,
+                "latency %-8s p50 ms: %7.2f, p99 ms: %7.2f\n",
+                STAGE_NAMES[i],
+                stages[i]->get_percentile_ms(0.5),
+                stages[i]->get_percentile_ms(0.99)
+            );
+        }
+    }
+
+    if (!options.is_timed) return 0;
+    for (int id : graph.order) {
+        auto it = graph.profiler.timings.find(id);
+        if (it == graph.profiler.timings.end()) continue;
+        auto &timing = it->second;
+
+        auto name = graph.nodes[id]->name.c_str();
+        double cpu_ms = timing.total_cpu_ms / timing.n_cpu_frames;
+        fprintf(stderr, "%-20s cpu ms: %7.2f", name, cpu_ms);
+        if (timing.n_gpu_frames) {
+            double gpu_ms = timing.total_gpu_ms / timing.n_gpu_frames;
+            fprintf(stderr, ", gpu ms: %7.2f", gpu_ms);
+        }
+        fprintf(stderr, "\n");
+    }
+    return 0;
+}
+
+// -----------------------------------------------------------------------
+// batch
+// Workers take the next file from a shared counter, so the long files don't
+// stall a static shard. Each worker builds its graph once and only rebinds
+// the sources for the next files.
+class Batch {
+public:
+    const Options &options;
+    std::atomic<size_t> next_input;
+
+    std::mutex mutex;
+    int n_failed;
+    int n_frames;
+
+    Batch(const Options &options)
+        : options(options)
+        , next_input(0)
+        , n_failed(0)
+        , n_frames(0) {}
+
+    void report(const crude_json::value &event) {
+        std::lock_guard<std::mutex> lock(mutex);
+        printf("%s\n", event.dump().c_str());
+        fflush(stdout);
+    }
+};
+
+static crude_json::value create_event(
+    const std::string &name, int worker, const std::string &input
+) {
+    crude_json::value event(crude_json::type_t::object);
+    event["event"] = name;
+    event["worker"] = (crude_json::number)worker;
+    event["file"] = input;
+    return event;
+}
+
+static std::string get_output(const std::string &pattern, const std::string &input) {
+    std::string output = pattern;
+    auto pos = output.find("{}");
+    if (pos != std::string::npos) {
+        output.replace(pos, 2, std::filesystem::path(input).stem().string());
+    }
+    return output;
+}
+
+static void run_worker(Batch &batch, int worker) {
+    const Options &options = batch.options;
+    if (options.n_jobs > 1) set_trace_thread_name("worker");
+    set_max_threads(std::max(options.n_threads / options.n_jobs, 1));
+
+    Graph graph;
+    std::shared_ptr<Node> sink;
+    size_t idx;
+    while ((idx = batch.next_input++) < options.inputs.size()) {
+        const std::string &input = options.inputs[idx];
+        batch.report(create_event("start", worker, input));
+
+        auto start = std::chrono::steady_clock::now();
+        auto get_seconds = [&] {
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now()
+                                                    - start;
+            return elapsed.count();
+        };
+
+        try {
+            if (sink) {
+                rebind_sources(graph, input, sink);
+            } else {
+                sink = build_graph(graph, options, input);
+            }
+
+            double last_report = 0.0;
+            auto on_frame = [&](const FileStats &stats) {
+                double seconds = get_seconds();
+                if (seconds - last_report < 1.0) return;
+                last_report = seconds;
+
+                auto event = create_event("progress", worker, input);
+                event["frames"] = (crude_json::number)stats.n_frames;
+                event["fps"] = stats.n_frames / seconds;
+                batch.report(event);
+            };
+            FileStats stats = process_file(
+                graph, sink, options, get_output(options.output, input), on_frame
+            );
+
+            double seconds = get_seconds();
+            auto event = create_event("done", worker, input);
+            event["frames"] = (crude_json::number)stats.n_frames;
+            event["seconds"] = seconds;
+            event["fps"] = seconds > 0.0 ? stats.n_frames / seconds : 0.0;
+            event["ms_per_frame"] = stats.n_frames ? stats.process_ms / stats.n_frames
+                                                   : 0.0;
+            if (options.is_timed) event["timings"] = get_timings(graph);
+            if (options.is_latency_reported) event["latency"] = get_latency(graph);
+            batch.report(event);
+
+            std::lock_guard<std::mutex> lock(batch.mutex);
+            batch.n_frames += stats.n_frames;
+        } catch (const std::exception &e) {
+            auto event = create_event("error", worker, input);
+            event["error"] = e.what();
+            batch.report(event);
+
+            // the graph might be half rebound, the next file rebuilds it
+            graph.clear();
+            sink = nullptr;
+            std::lock_guard<std::mutex> lock(batch.mutex);
+            batch.n_failed += 1;
+        }
+    }
+}
+
+static int run_batch(const Options &options) {
+    // the workers are the parallelism, the opencv pool would only add
+    // threads over the budget
+    if (options.n_jobs > 1) cv::setNumThreads(1);
+
+    Batch batch(options);
+    auto start = std::chrono::steady_clock::now();
+    if (options.n_jobs == 1) {
+        run_worker(batch, 0);
+    } else {
+        std::vector<std::thread> workers;
+        for (int i = 0; i < options.n_jobs; ++i) {
+            workers.emplace_back(run_worker, std::ref(batch), i);
+        }
+        for (auto &worker : workers) worker.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    crude_json::value event(crude_json::type_t::object);
+    event["event"] = "summary";
+    event["files"] = (crude_json::number)options.inputs.size();
+    event["failed"] = (crude_json::number)batch.n_failed;
+    event["frames"] = (crude_json::number)batch.n_frames;
+    event["seconds"] = elapsed.count();
+    event["fps"] = elapsed.count() > 0.0 ? batch.n_frames / elapsed.count() : 0.0;
+    batch.report(event);
+    return batch.n_failed ? 1 : 0;
+}
+
+static int run(const Options &options) {
+    // created first, so it's destroyed after the graph resources
+    std::unique_ptr<OffscreenContext> gl_context;
+    if (options.is_gpu) gl_context = std::make_unique<OffscreenContext>();
+
+    set_trace_thread_name("main");
+    if (!options.trace.empty()) start_trace();
+    int code = options.is_batch ? run_batch(options) : run_single(options);
+    if (!options.trace.empty()) save_trace(options.trace);
+    return code;
+}
+
+int main(int argc, char **argv) {
+    try {
+        return run(parse_options(argc, argv));
+    } catch (const std::exception &e) {
+        fprintf(stderr, "%s\n%s", e.what(), USAGE);
+        return 1;
+    }
+}
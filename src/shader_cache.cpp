@@ -0,0 +1,308 @@
+#include "shader_cache.hpp"
+
+#include "gl.hpp"
+#include "raylib/rlgl.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <unordered_map>
+#include <vector>
+
+static const std::string SHADER_CACHE_DIR = "shader_cache";
+
+static std::unordered_map<std::string, Shader> &get_shaders() {
+    static std::unordered_map<std::string, Shader> shaders;
+    return shaders;
+}
+
+// FNV-1a, unlike std::hash it's the same in every build
+static uint64_t get_hash(const std::string &str) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : str) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// a binary is only valid for the driver which produced it
+static std::string get_driver_string() {
+    std::string driver;
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        driver += (const char *)glGetString(name);
+        driver += "\n";
+    }
+    return driver;
+}
+
+static bool has_parallel_compile() {
+    static bool has = []() {
+        GLint n_extensions = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &n_extensions);
+        for (int i = 0; i < n_extensions; ++i) {
+            auto name = (const char *)glGetStringi(GL_EXTENSIONS, i);
+            if (std::strcmp(name, "GL_KHR_parallel_shader_compile") == 0) return true;
+            if (std::strcmp(name, "GL_ARB_parallel_shader_compile") == 0) return true;
+        }
+        return false;
+    }();
+    return has;
+}
+
+// some drivers have the functions but no binary format, e.g. without
+// ARB_get_program_binary or on mesa with the shader cache off
+static bool has_binaries() {
+    static bool has = []() {
+        if (!glGetProgramBinary || !glProgramBinary || !glProgramParameteri) {
+            return false;
+        }
+        GLint n_formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &n_formats);
+        return n_formats > 0;
+    }();
+    return has;
+}
+
+// "" if the driver can't load the binaries
+static std::string get_binary_path(const std::string &key) {
+    if (!has_binaries()) return "";
+
+    static std::string driver = get_driver_string();
+    unsigned long long hash = get_hash(driver + key);
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", hash);
+    return SHADER_CACHE_DIR + "/" + name;
+}
+
+// the same locations LoadShaderFromMemory() finds, rlgl draws with them
+static Shader get_program_shader(unsigned int program) {
+    Shader shader = {
+        .id = program, .locs = (int *)RL_CALLOC(RL_MAX_SHADER_LOCATIONS, sizeof(int))
+    };
+    for (int i = 0; i < RL_MAX_SHADER_LOCATIONS; ++i) shader.locs[i] = -1;
+
+    int *locs = shader.locs;
+    locs[SHADER_LOC_VERTEX_POSITION] = rlGetLocationAttrib(program, "vertexPosition");
+    locs[SHADER_LOC_VERTEX_TEXCOORD01] = rlGetLocationAttrib(program, "vertexTexCoord");
+    locs[SHADER_LOC_VERTEX_TEXCOORD02] = rlGetLocationAttrib(program, "vertexTexCoord2");
+    locs[SHADER_LOC_VERTEX_NORMAL] = rlGetLocationAttrib(program, "vertexNormal");
+    locs[SHADER_LOC_VERTEX_TANGENT] = rlGetLocationAttrib(program, "vertexTangent");
+    locs[SHADER_LOC_VERTEX_COLOR] = rlGetLocationAttrib(program, "vertexColor");
+    locs[SHADER_LOC_MATRIX_MVP] = rlGetLocationUniform(program, "mvp");
+    locs[SHADER_LOC_MATRIX_VIEW] = rlGetLocationUniform(program, "matView");
+    locs[SHADER_LOC_MATRIX_PROJECTION] = rlGetLocationUniform(program, "matProjection");
+    locs[SHADER_LOC_MATRIX_MODEL] = rlGetLocationUniform(program, "matModel");
+    locs[SHADER_LOC_MATRIX_NORMAL] = rlGetLocationUniform(program, "matNormal");
+    locs[SHADER_LOC_COLOR_DIFFUSE] = rlGetLocationUniform(program, "colDiffuse");
+    locs[SHADER_LOC_MAP_DIFFUSE] = rlGetLocationUniform(program, "texture0");
+    locs[SHADER_LOC_MAP_SPECULAR] = rlGetLocationUniform(program, "texture1");
+    locs[SHADER_LOC_MAP_NORMAL] = rlGetLocationUniform(program, "texture2");
+    return shader;
+}
+
+// 0 if there's no binary or the driver rejects it, e.g. after an update
+static unsigned int load_binary(const std::string &path) {
+    if (path.empty()) return 0;
+    std::ifstream file(path, std::ios::binary);
+    uint32_t format = 0;
+    if (!file.read((char *)&format, sizeof(format))) return 0;
+    std::vector<char> data(
+        (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()
+    );
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, format, data.data(), data.size());
+    GLint is_linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &is_linked);
+    if (!is_linked) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+static void save_binary(unsigned int program, const std::string &path) {
+    if (path.empty()) return;
+    GLint size = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (size == 0) {
+        static bool is_logged = false;
+        if (!is_logged) TraceLog(LOG_WARNING, "SHADER: Driver returned no binary");
+        is_logged = true;
+        return;
+    }
+
+    std::vector<char> data(size);
+    GLenum format = 0;
+    glGetProgramBinary(program, size, &size, &format, data.data());
+
+    // renamed once complete, so that another run never reads a partial file
+    std::error_code error;
+    std::filesystem::create_directories(SHADER_CACHE_DIR, error);
+    std::string tmp_path = path + ".tmp";
+    std::ofstream file(tmp_path, std::ios::binary);
+    uint32_t format_ = format;
+    file.write((const char *)&format_, sizeof(format_));
+    file.write(data.data(), size);
+    file.close();
+    if (file) std::filesystem::rename(tmp_path, path, error);
+}
+
+// without the hint some drivers return no binary
+static void link_program(unsigned int program) {
+    if (has_binaries()) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(program);
+}
+
+static unsigned int compile_shader(GLenum type, const std::string &src) {
+    GLuint shader = glCreateShader(type);
+    const char *src_ = src.c_str();
+    glShaderSource(shader, 1, &src_, nullptr);
+    glCompileShader(shader);
+    return shader;
+}
+
+// the logs end with a newline, TraceLog() adds its own
+static void log_error(const char *log) {
+    std::string message = log;
+    while (!message.empty() && message.back() == '\n') message.pop_back();
+    TraceLog(LOG_WARNING, "SHADER: %s", message.c_str());
+}
+
+static void log_errors(
+    const std::vector<unsigned int> &stages, unsigned int program
+) {
+    char log[4096];
+    for (GLuint shader : stages) {
+        GLint is_compiled = 0;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &is_compiled);
+        if (is_compiled) continue;
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        log_error(log);
+    }
+    glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+    log_error(log);
+}
+
+// -----------------------------------------------------------------------
+// shader build
+ShaderBuild::ShaderBuild(const std::string &vs_src, const std::string &fs_src)
+    : key(vs_src + '\0' + fs_src)
+    , program(0)
+    , n_polls(0)
+    , shader({.id = 0, .locs = nullptr}) {
+    auto it = get_shaders().find(key);
+    if (it != get_shaders().end()) {
+        this->shader = it->second;
+        return;
+    }
+
+    this->program = load_binary(get_binary_path(key));
+    if (this->program) {
+        finish();
+        return;
+    }
+
+    this->stages.push_back(compile_shader(GL_VERTEX_SHADER, vs_src));
+    this->stages.push_back(compile_shader(GL_FRAGMENT_SHADER, fs_src));
+    this->program = glCreateProgram();
+    for (GLuint stage : this->stages) glAttachShader(this->program, stage);
+
+    // the attribute locations rlgl draws with
+    glBindAttribLocation(this->program, 0, "vertexPosition");
+    glBindAttribLocation(this->program, 1, "vertexTexCoord");
+    glBindAttribLocation(this->program, 2, "vertexNormal");
+    glBindAttribLocation(this->program, 3, "vertexColor");
+    glBindAttribLocation(this->program, 4, "vertexTangent");
+    glBindAttribLocation(this->program, 5, "vertexTexCoord2");
+    link_program(this->program);
+}
+
+ShaderBuild::ShaderBuild(const std::string &cs_src)
+    : key(cs_src)
+    , program(0)
+    , n_polls(0)
+    , shader({.id = 0, .locs = nullptr}) {
+    auto it = get_shaders().find(key);
+    if (it != get_shaders().end()) {
+        this->shader = it->second;
+        return;
+    }
+
+    this->program = load_binary(get_binary_path(key));
+    if (this->program) {
+        finish();
+        return;
+    }
+
+    this->stages.push_back(compile_shader(GL_COMPUTE_SHADER, cs_src));
+    this->program = glCreateProgram();
+    glAttachShader(this->program, this->stages[0]);
+    link_program(this->program);
+}
+
+ShaderBuild::~ShaderBuild() {
+    if (this->shader.id != 0) return;
+    glDeleteProgram(this->program);
+    for (GLuint stage : this->stages) glDeleteShader(stage);
+}
+
+void ShaderBuild::finish() {
+    GLint is_linked = 0;
+    glGetProgramiv(this->program, GL_LINK_STATUS, &is_linked);
+
+    if (is_linked) {
+        // only the compiled programs, the loaded ones are saved already
+        if (!this->stages.empty()) {
+            save_binary(this->program, get_binary_path(this->key));
+        }
+        this->shader = get_program_shader(this->program);
+        get_shaders()[this->key] = this->shader;
+    } else {
+        log_errors(this->stages, this->program);
+        glDeleteProgram(this->program);
+        this->shader = {.id = rlGetShaderIdDefault(), .locs = rlGetShaderLocsDefault()};
+    }
+
+    for (GLuint stage : this->stages) {
+        if (is_linked) glDetachShader(this->program, stage);
+        glDeleteShader(stage);
+    }
+}
+
+bool ShaderBuild::is_done() {
+    if (this->shader.id != 0) return true;
+
+    if (has_parallel_compile()) {
+        GLint is_completed = 0;
+        glGetProgramiv(this->program, GL_COMPLETION_STATUS_KHR, &is_completed);
+        if (!is_completed) return false;
+    } else if (this->n_polls++ == 0) {
+        return false;
+    }
+
+    finish();
+    return true;
+}
+
+Shader ShaderBuild::get_shader() {
+    if (this->shader.id == 0) finish();
+    return this->shader;
+}
+
+bool ShaderBuild::is_failed() {
+    return get_shader().id == rlGetShaderIdDefault();
+}
+
+Shader load_cached_shader(const std::string &vs_src, const std::string &fs_src) {
+    return ShaderBuild(vs_src, fs_src).get_shader();
+}
+
+Shader load_cached_compute_shader(const std::string &cs_src) {
+    return ShaderBuild(cs_src).get_shader();
+}
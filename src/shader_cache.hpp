@@ -0,0 +1,43 @@
+#pragma once
+#include "raylib/raylib.h"
+#include <string>
+#include <vector>
+
+// Linked programs by their sources. A program is linked once and shared by
+// all the passes with the same sources, so the shaders must not be unloaded,
+// they live until the gl context is destroyed. The program binaries are also
+// saved to SHADER_CACHE_DIR, keyed by a hash of the sources and the driver
+// strings, and the next runs load them without compiling.
+
+// Compiles and links a program without waiting for the driver. is_done()
+// never blocks with KHR_parallel_shader_compile, without it the status is
+// queried on the second call, usually a frame later, when most drivers are
+// done. Cached programs are done right away.
+class ShaderBuild {
+private:
+    std::string key;
+    unsigned int program;
+    // the compiled stages, none for the cached programs
+    std::vector<unsigned int> stages;
+    int n_polls;
+    Shader shader;
+
+    void finish();
+
+public:
+    ShaderBuild(const std::string &vs_src, const std::string &fs_src);
+    // a compute program, it has no attributes, so only the id is useful
+    ShaderBuild(const std::string &cs_src);
+    ~ShaderBuild();
+
+    bool is_done();
+
+    // blocks until done, the default shader if the compilation failed, the
+    // errors are logged
+    Shader get_shader();
+    bool is_failed();
+};
+
+// a finished build, the default shader if the compilation failed
+Shader load_cached_shader(const std::string &vs_src, const std::string &fs_src);
+Shader load_cached_compute_shader(const std::string &cs_src);
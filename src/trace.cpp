@@ -0,0 +1,220 @@
+#include "trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+// events per thread, 4 MB. A node records two events per frame (links and
+// update), so the main thread of a 10 node graph at 60 fps fills it in
+// about 50 s, trace shorter runs of the bigger graphs
+static const size_t TRACE_BUFFER_SIZE = 1 << 16;
+
+class TraceEvent {
+public:
+    const char *category;
+    // node names are freed with their nodes
+    char name[40];
+    int64_t start_ns;
+    int64_t duration_ns;
+};
+
+// Written by its thread only: an event is filled before n_events is
+// released, so save_trace() reads the events below n_events without a lock.
+class TraceBuffer {
+public:
+    std::vector<TraceEvent> events;
+    std::atomic<size_t> n_events;
+    // TRACE_GENERATION of the events
+    std::atomic<int> generation;
+    // the thread has exited, the buffer is reused by the next trace
+    std::atomic<bool> is_free;
+    int tid;
+    const char *thread_name;
+
+    TraceBuffer(int tid)
+        : events(TRACE_BUFFER_SIZE)
+        , n_events(0)
+        , generation(-1)
+        , is_free(false)
+        , tid(tid)
+        , thread_name(nullptr) {}
+};
+
+static std::atomic<bool> IS_TRACING = false;
+// incremented by start_trace(), the buffers of the older ones are dropped
+static std::atomic<int> TRACE_GENERATION = 0;
+
+// the buffers are only added under the mutex, once per thread and trace
+static std::mutex BUFFERS_MUTEX;
+static std::vector<std::unique_ptr<TraceBuffer>> BUFFERS;
+
+class ThreadBuffer {
+public:
+    TraceBuffer *buffer = nullptr;
+    const char *name = nullptr;
+
+    ~ThreadBuffer() {
+        if (buffer) buffer->is_free = true;
+    }
+};
+
+static thread_local ThreadBuffer THREAD_BUFFER;
+
+static int64_t get_time_ns() {
+    auto time = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time).count();
+}
+
+static TraceBuffer *get_thread_buffer() {
+    int generation = TRACE_GENERATION.load(std::memory_order_acquire);
+    TraceBuffer *buffer = THREAD_BUFFER.buffer;
+    if (buffer && buffer->generation.load(std::memory_order_relaxed) == generation) {
+        return buffer;
+    }
+
+    if (!buffer) {
+        std::lock_guard<std::mutex> lock(BUFFERS_MUTEX);
+        // the free buffers of the previous traces, the current one keeps the
+        // events of its exited threads
+        for (auto &free_buffer : BUFFERS) {
+            bool is_stale = free_buffer->generation != generation;
+            if (free_buffer->is_free && is_stale) {
+                free_buffer->is_free = false;
+                buffer = free_buffer.get();
+                break;
+            }
+        }
+        if (!buffer) {
+            BUFFERS.push_back(std::make_unique<TraceBuffer>(BUFFERS.size() + 1));
+            buffer = BUFFERS.back().get();
+        }
+        buffer->thread_name = THREAD_BUFFER.name;
+        THREAD_BUFFER.buffer = buffer;
+    }
+
+    buffer->n_events.store(0, std::memory_order_relaxed);
+    buffer->generation.store(generation, std::memory_order_release);
+    return buffer;
+}
+
+void start_trace() {
+    TRACE_GENERATION += 1;
+    IS_TRACING.store(true, std::memory_order_release);
+}
+
+void stop_trace() {
+    IS_TRACING.store(false, std::memory_order_release);
+}
+
+bool is_tracing() {
+    return IS_TRACING.load(std::memory_order_relaxed);
+}
+
+void set_trace_thread_name(const char *name) {
+    THREAD_BUFFER.name = name;
+    std::lock_guard<std::mutex> lock(BUFFERS_MUTEX);
+    if (THREAD_BUFFER.buffer) THREAD_BUFFER.buffer->thread_name = name;
+}
+
+TraceScope::TraceScope(const char *category, const char *name)
+    : category(category)
+    , name(nullptr)
+    , start_ns(0) {
+    if (!is_tracing()) return;
+    this->name = name;
+    this->start_ns = get_time_ns();
+}
+
+TraceScope::~TraceScope() {
+    if (!this->name || !is_tracing()) return;
+
+    TraceBuffer *buffer = get_thread_buffer();
+    size_t idx = buffer->n_events.load(std::memory_order_relaxed);
+    if (idx == buffer->events.size()) return;
+
+    TraceEvent &event = buffer->events[idx];
+    event.category = this->category;
+    std::strncpy(event.name, this->name, sizeof(event.name) - 1);
+    event.name[sizeof(event.name) - 1] = '\0';
+    event.start_ns = this->start_ns;
+    event.duration_ns = get_time_ns() - this->start_ns;
+    buffer->n_events.store(idx + 1, std::memory_order_release);
+}
+
+// the names come from the node names and literals, only quotes and
+// backslashes need escaping
+static std::string escape(const char *str) {
+    std::string escaped;
+    for (; *str; ++str) {
+        if (*str == '"' || *str == '\\') escaped += '\\';
+        if ((unsigned char)*str >= 0x20) escaped += *str;
+    }
+    return escaped;
+}
+
+void save_trace(const std::string &file_name) {
+    std::ofstream file(file_name);
+    if (!file) throw std::runtime_error("Failed to open " + file_name);
+
+    int generation = TRACE_GENERATION.load(std::memory_order_acquire);
+    std::lock_guard<std::mutex> lock(BUFFERS_MUTEX);
+
+    // the timestamps are in microseconds relative to the first event
+    int64_t start_ns = INT64_MAX;
+    for (auto &buffer : BUFFERS) {
+        if (buffer->generation.load(std::memory_order_acquire) != generation) continue;
+        size_t n_events = buffer->n_events.load(std::memory_order_acquire);
+        for (size_t i = 0; i < n_events; ++i) {
+            start_ns = std::min(start_ns, buffer->events[i].start_ns);
+        }
+    }
+
+    char line[256];
+    const char *separator = "\n";
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    for (auto &buffer : BUFFERS) {
+        if (buffer->generation.load(std::memory_order_acquire) != generation) continue;
+        size_t n_events = buffer->n_events.load(std::memory_order_acquire);
+
+        if (buffer->thread_name) {
+            std::snprintf(
+                line,
+                sizeof(line),
+                "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+                "\"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+                separator,
+                buffer->tid,
+                escape(buffer->thread_name).c_str()
+            );
+            file << line;
+            separator = ",\n";
+        }
+
+        for (size_t i = 0; i < n_events; ++i) {
+            TraceEvent &event = buffer->events[i];
+            std::snprintf(
+                line,
+                sizeof(line),
+                "%s{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, "
+                "\"dur\": %.3f, \"pid\": 1, \"tid\": %d}",
+                separator,
+                escape(event.name).c_str(),
+                event.category,
+                (event.start_ns - start_ns) / 1e3,
+                event.duration_ns / 1e3,
+                buffer->tid
+            );
+            file << line;
+            separator = ",\n";
+        }
+    }
+    file << "\n]}\n";
+    if (!file) throw std::runtime_error("Failed to write " + file_name);
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Chrome trace events of the frame pipeline, open the saved file in
+// chrome://tracing or ui.perfetto.dev. Each thread records into a buffer of
+// its own, so the recording never locks, a full buffer drops the rest of its
+// events. While tracing is off a scope costs a single atomic load.
+
+// drops the events of the previous trace
+void start_trace();
+void stop_trace();
+bool is_tracing();
+
+// writes the events of the current (or the last) trace, throws on errors
+void save_trace(const std::string &file_name);
+
+// the name of the calling thread in the trace, must be a literal
+void set_trace_thread_name(const char *name);
+
+// records the time from the construction to the destruction, the strings
+// must outlive the scope, the name is copied
+class TraceScope {
+private:
+    const char *category;
+    const char *name;
+    int64_t start_ns;
+
+public:
+    TraceScope(const char *category, const char *name);
+    ~TraceScope();
+};
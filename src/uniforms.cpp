@@ -0,0 +1,152 @@
+#include "uniforms.hpp"
+
+#include "gl.hpp"
+#include <cstring>
+
+std::unordered_map<std::string, int> get_uniform_locations(unsigned int program) {
+    std::unordered_map<std::string, int> locations;
+    int n_uniforms = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &n_uniforms);
+
+    for (int i = 0; i < n_uniforms; ++i) {
+        char name[256];
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(program, i, sizeof(name), nullptr, &size, &type, name);
+
+        // the block members don't have locations
+        int location = glGetUniformLocation(program, name);
+        if (location != -1) locations[name] = location;
+    }
+    return locations;
+}
+
+UniformBlock::UniformBlock()
+    : buffer(0)
+    , binding(0)
+    , is_changed(false) {}
+
+UniformBlock::~UniformBlock() {
+    if (this->buffer) glDeleteBuffers(1, &this->buffer);
+}
+
+void UniformBlock::load(unsigned int program, const std::string &name, int binding) {
+    // loaded again when the shader is reloaded
+    if (this->buffer) glDeleteBuffers(1, &this->buffer);
+    this->buffer = 0;
+    this->offsets.clear();
+
+    GLuint block_idx = glGetUniformBlockIndex(program, name.c_str());
+    if (block_idx == GL_INVALID_INDEX) return;
+
+    this->binding = binding;
+    glUniformBlockBinding(program, block_idx, binding);
+
+    GLint size = 0;
+    GLint n_members = 0;
+    glGetActiveUniformBlockiv(program, block_idx, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+    glGetActiveUniformBlockiv(
+        program, block_idx, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &n_members
+    );
+
+    std::vector<GLint> indices(n_members);
+    std::vector<GLint> offsets(n_members);
+    glGetActiveUniformBlockiv(
+        program, block_idx, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES, indices.data()
+    );
+    glGetActiveUniformsiv(
+        program,
+        n_members,
+        (const GLuint *)indices.data(),
+        GL_UNIFORM_OFFSET,
+        offsets.data()
+    );
+
+    for (int i = 0; i < n_members; ++i) {
+        char member_name[256];
+        GLint member_size;
+        GLenum type;
+        glGetActiveUniform(
+            program,
+            indices[i],
+            sizeof(member_name),
+            nullptr,
+            &member_size,
+            &type,
+            member_name
+        );
+        this->offsets[member_name] = offsets[i];
+    }
+
+    this->data.assign(size, 0);
+    this->is_changed = true;
+    glGenBuffers(1, &this->buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, this->buffer);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+int UniformBlock::get_offset(const std::string &name) {
+    auto it = this->offsets.find(name);
+    return it == this->offsets.end() ? -1 : it->second;
+}
+
+void UniformBlock::set(int offset, const void *value, size_t size) {
+    if (offset < 0) return;
+    unsigned char *dst = this->data.data() + offset;
+    if (std::memcmp(dst, value, size) == 0) return;
+    std::memcpy(dst, value, size);
+    this->is_changed = true;
+}
+
+void UniformBlock::bind() {
+    bind(this->binding);
+}
+
+void UniformBlock::bind(int binding) {
+    if (this->buffer == 0) return;
+    if (this->is_changed) {
+        glBindBuffer(GL_UNIFORM_BUFFER, this->buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, this->data.size(), this->data.data());
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        this->is_changed = false;
+    }
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, this->buffer);
+}
+
+void set_block_binding(unsigned int program, const std::string &name, int binding) {
+    GLuint block_idx = glGetUniformBlockIndex(program, name.c_str());
+    if (block_idx != GL_INVALID_INDEX) {
+        glUniformBlockBinding(program, block_idx, binding);
+    }
+}
+
+// -----------------------------------------------------------------------
+// frame block
+void load_frame_block(unsigned int program) {
+    set_block_binding(program, "Frame", FRAME_BINDING);
+}
+
+// same layout as the block in common.glsl, std140 packs the scalars tightly
+class FrameUniforms {
+public:
+    float time;
+    int frame_idx;
+};
+
+// the buffer lives until the gl context is destroyed
+void update_frame_uniforms(float time, int frame_idx) {
+    static unsigned int buffer = 0;
+    if (buffer == 0) {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferData(GL_UNIFORM_BUFFER, 16, nullptr, GL_DYNAMIC_DRAW);
+    } else {
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    }
+
+    FrameUniforms uniforms = {.time = time, .frame_idx = frame_idx};
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(uniforms), &uniforms);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_BINDING, buffer);
+}
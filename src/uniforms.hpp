@@ -0,0 +1,54 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Uniform binding points of the blocks declared by the shaders
+enum UniformBinding {
+    // Frame in common.glsl, shared by all the shaders
+    FRAME_BINDING = 0,
+    // Params of a node shader, a buffer per node
+    PARAMS_BINDING = 1,
+};
+
+// locations of the active uniforms outside the blocks, by name, resolved
+// once so that no name is looked up in the driver on each frame
+std::unordered_map<std::string, int> get_uniform_locations(unsigned int program);
+
+// A std140 uniform block of a program. Values are written to a cpu copy and
+// the buffer is updated on bind() only if the copy has changed.
+class UniformBlock {
+private:
+    unsigned int buffer;
+    int binding;
+    std::vector<unsigned char> data;
+    bool is_changed;
+    std::unordered_map<std::string, int> offsets;
+
+public:
+    UniformBlock();
+    ~UniformBlock();
+
+    // finds the block in the program and assigns it the binding point, the
+    // block stays empty if the program doesn't have it
+    void load(unsigned int program, const std::string &name, int binding);
+
+    // offset of the member, -1 if there's none
+    int get_offset(const std::string &name);
+    void set(int offset, const void *value, size_t size);
+
+    // uploads the changed values and binds the buffer to the binding point
+    void bind();
+    // same, but to another binding point, e.g. of the block renamed in a fused
+    // shader, the std140 layout of the copy is the same
+    void bind(int binding);
+};
+
+// assigns the binding point of the block of the program if it has one
+void set_block_binding(unsigned int program, const std::string &name, int binding);
+
+// assigns the binding point of the Frame block of the program
+void load_frame_block(unsigned int program);
+
+// the Frame block: called once per frame before the nodes are drawn
+void update_frame_uniforms(float time, int frame_idx);
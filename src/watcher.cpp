@@ -0,0 +1,39 @@
+#include "watcher.hpp"
+
+#include "raylib/raylib.h"
+#include <algorithm>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+FileWatcher::FileWatcher(const std::string &dir)
+    : fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {
+    // editors either write the file in place or rename a new one over it
+    uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO;
+    if (this->fd == -1 || inotify_add_watch(this->fd, dir.c_str(), mask) == -1) {
+        TraceLog(LOG_WARNING, "WATCHER: Failed to watch %s", dir.c_str());
+    }
+}
+
+FileWatcher::~FileWatcher() {
+    if (this->fd != -1) close(this->fd);
+}
+
+std::vector<std::string> FileWatcher::take_changes() {
+    std::vector<std::string> changes;
+    if (this->fd == -1) return changes;
+
+    alignas(inotify_event) char buffer[4096];
+    ssize_t size;
+    while ((size = read(this->fd, buffer, sizeof(buffer))) > 0) {
+        for (char *p = buffer; p < buffer + size;) {
+            auto event = (inotify_event *)p;
+            p += sizeof(inotify_event) + event->len;
+            if (event->len == 0) continue;
+
+            std::string name = event->name;
+            auto it = std::find(changes.begin(), changes.end(), name);
+            if (it == changes.end()) changes.push_back(name);
+        }
+    }
+    return changes;
+}
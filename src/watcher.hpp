@@ -0,0 +1,17 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Watches the files of a directory with inotify. The descriptor is
+// non-blocking, so take_changes() can be called on each frame.
+class FileWatcher {
+private:
+    int fd;
+
+public:
+    FileWatcher(const std::string &dir);
+    ~FileWatcher();
+
+    // names of the files written since the last call, each one once
+    std::vector<std::string> take_changes();
+};
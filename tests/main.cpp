@@ -0,0 +1,37 @@
+#include "test.hpp"
+
+#include <cstdio>
+#include <exception>
+
+static int N_FAILED_CHECKS = 0;
+
+std::vector<Test> &get_tests() {
+    static std::vector<Test> tests;
+    return tests;
+}
+
+void fail_check(const char *file, int line, const char *expr) {
+    fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, expr);
+    N_FAILED_CHECKS += 1;
+}
+
+// runs all the tests, the exit code is 1 if any of them failed
+int main() {
+    int n_failed = 0;
+    for (auto &test : get_tests()) {
+        int n_failed_checks = N_FAILED_CHECKS;
+        try {
+            test.fn();
+        } catch (const std::exception &e) {
+            fprintf(stderr, "%s: %s\n", test.name, e.what());
+            N_FAILED_CHECKS += 1;
+        }
+
+        bool is_passed = N_FAILED_CHECKS == n_failed_checks;
+        fprintf(stderr, "%s %s\n", is_passed ? "PASS" : "FAIL", test.name);
+        if (!is_passed) n_failed += 1;
+    }
+
+    fprintf(stderr, "%d of %zu tests failed\n", n_failed, get_tests().size());
+    return n_failed ? 1 : 0;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <functional>
+#include <vector>
+
+// A minimal test runner, see main.cpp. TEST() registers a function, a failed
+// CHECK() prints its location and fails the test, which still runs to the end.
+
+class Test {
+public:
+    const char *name;
+    std::function<void()> fn;
+};
+
+std::vector<Test> &get_tests();
+void fail_check(const char *file, int line, const char *expr);
+
+class TestRegistration {
+public:
+    TestRegistration(const char *name, std::function<void()> fn) {
+        get_tests().push_back({name, fn});
+    }
+};
+
+#define TEST(name)                                              \
+    static void name();                                         \
+    static TestRegistration name##_registration(#name, name);   \
+    static void name()
+
+#define CHECK(expr)                                                  \
+    do {                                                             \
+        if (!(expr)) fail_check(__FILE__, __LINE__, #expr);          \
+    } while (0)
@@ -0,0 +1,97 @@
+#include "cpu.hpp"
+#include "graph.hpp"
+#include "opencv2/core.hpp"
+#include "opencv2/imgproc.hpp"
+#include "test.hpp"
+#include <cmath>
+#include <memory>
+#include <vector>
+
+// uniform noise in [0, 1], the rng of opencv has a fixed seed
+static cv::Mat get_random_frame(int width, int height, int type = CV_32FC3) {
+    cv::Mat frame(height, width, type);
+    cv::randu(frame, 0.0, 1.0);
+    return frame;
+}
+
+static double get_max_diff(const cv::Mat &a, const cv::Mat &b) {
+    if (a.size() != b.size() || a.type() != b.type()) return INFINITY;
+    return cv::norm(a, b, cv::NORM_INF);
+}
+
+static CpuKernelKind get_kind(std::shared_ptr<Node> node) {
+    return node->context->get_cpu_kernel()->get_kind(node->pins);
+}
+
+// -----------------------------------------------------------------------
+// fused runs
+TEST(fused_run_matches_split_run) {
+    Graph graph;
+    auto first = graph.create_node_by_name("Color Correction");
+    get_pin(first->pins, "exposure")._float.val = 0.5f;
+    get_pin(first->pins, "saturation")._float.val = 1.5f;
+    auto pixelization = graph.create_node_by_name("Pixelization");
+    get_pin(pixelization->pins, "pixel_size")._int.val = 5;
+    auto last = graph.create_node_by_name("Color Correction");
+    get_pin(last->pins, "contrast")._float.val = 1.5f;
+    get_pin(last->pins, "gamma")._float.val = 2.2f;
+    std::vector<std::shared_ptr<Node>> nodes = {first, pixelization, last};
+
+    // an odd size, so that neither the pixels nor the tiles line up
+    cv::Mat src = get_random_frame(301, 203);
+    CpuBackend backend;
+
+    CpuStep fused = {nodes, get_kind(first), CpuPrecision::F32};
+    cv::Mat fused_dst;
+    backend.run(fused, src, fused_dst);
+
+    cv::Mat split_dst = src;
+    for (auto &node : nodes) {
+        CpuStep step = {{node}, get_kind(node), CpuPrecision::F32};
+        cv::Mat dst;
+        backend.run(step, split_dst, dst);
+        split_dst = dst;
+    }
+
+    CHECK(get_max_diff(fused_dst, split_dst) < 1e-4);
+}
+
+// -----------------------------------------------------------------------
+// filters
+// the taps outside of the frame are skipped, so the zero padded sums are
+// divided by the number of taps inside
+static void get_box_blur_reference(const cv::Mat &src, cv::Mat &dst, int r) {
+    cv::Size size(2 * r + 1, 2 * r + 1);
+    cv::Mat sums, counts;
+    cv::boxFilter(src, sums, CV_32F, size, {-1, -1}, false, cv::BORDER_CONSTANT);
+    cv::Mat ones = cv::Mat::ones(src.size(), CV_32F);
+    cv::boxFilter(ones, counts, CV_32F, size, {-1, -1}, false, cv::BORDER_CONSTANT);
+
+    cv::Mat counts_rgb;
+    cv::merge(std::vector<cv::Mat>{counts, counts, counts}, counts_rgb);
+    cv::divide(sums, counts_rgb, dst);
+}
+
+TEST(box_blur_matches_opencv) {
+    cv::Mat src = get_random_frame(97, 61);
+    // larger than the frame too
+    for (int r : {0, 1, 4, 30, 100}) {
+        cv::Mat dst, expected;
+        box_blur(src, dst, r);
+        get_box_blur_reference(src, expected, r);
+        CHECK(get_max_diff(dst, expected) < 1e-4);
+    }
+}
+
+TEST(max_filter_matches_dilate) {
+    cv::Mat src = get_random_frame(97, 61, CV_32F);
+    for (int r : {0, 1, 3, 20, 70}) {
+        cv::Mat dst, expected;
+        max_filter(src, dst, r);
+        cv::Mat kernel = cv::getStructuringElement(
+            cv::MORPH_RECT, {2 * r + 1, 2 * r + 1}
+        );
+        cv::dilate(src, expected, kernel);
+        CHECK(get_max_diff(dst, expected) == 0.0);
+    }
+}
@@ -0,0 +1,98 @@
+#include "graph.hpp"
+#include "test.hpp"
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+static std::string read_file(const std::string &file_name) {
+    std::ifstream file(file_name, std::ios::binary);
+    std::stringstream stream;
+    stream << file.rdbuf();
+    return stream.str();
+}
+
+static std::string get_temp_file_name(const std::string &name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+// a chain of the nodes which open no files, with values off the defaults
+static void create_chain(Graph &graph) {
+    std::shared_ptr<Node> last;
+    for (auto name : {"Color Correction", "Color Quantization", "Color Outline"}) {
+        auto node = graph.create_node_by_name(name);
+        graph.create_node(node);
+        if (last) graph.create_link(Link(last->pins.back().id, node->pins[0].id));
+        last = node;
+    }
+
+    for (auto &[_, node] : graph.nodes) {
+        for (auto &pin : node->pins) {
+            if (pin.kind != PinKind::MANUAL) continue;
+            switch (pin.type) {
+                case PinType::INT: pin._int.val = pin._int.max; break;
+                case PinType::FLOAT: pin._float.val = pin._float.max; break;
+                case PinType::BOOL: pin._bool = !pin._bool; break;
+                case PinType::COLOR: pin._color = {0.25f, 0.5f, 0.75f}; break;
+                case PinType::TEXTURE: break;
+            }
+        }
+        node->preview = true;
+    }
+}
+
+// -----------------------------------------------------------------------
+// graph file
+TEST(graph_file_round_trip) {
+    for (auto extension : {".json", ".bin"}) {
+        std::string file_name = get_temp_file_name(
+            std::string("freska-test-0") + extension
+        );
+        std::string reloaded_file_name = get_temp_file_name(
+            std::string("freska-test-1") + extension
+        );
+
+        Graph graph;
+        create_chain(graph);
+        graph.save(file_name);
+
+        Graph reloaded;
+        reloaded.load(file_name);
+        reloaded.save(reloaded_file_name);
+
+        CHECK(reloaded.nodes.size() == graph.nodes.size());
+        CHECK(reloaded.links.size() == graph.links.size());
+        CHECK(read_file(reloaded_file_name) == read_file(file_name));
+
+        std::filesystem::remove(file_name);
+        std::filesystem::remove(reloaded_file_name);
+    }
+}
+
+TEST(graph_file_failed_load_keeps_graph) {
+    std::string file_name = get_temp_file_name("freska-test.json");
+    Graph graph;
+    create_chain(graph);
+    graph.save(file_name);
+
+    // the last link fails once all the nodes are created
+    std::string data = read_file(file_name);
+    size_t pos = data.find("\"frame\"", data.rfind("\"end_pin\""));
+    data.replace(pos, std::string("\"frame\"").size(), "\"missing\"");
+    std::ofstream(file_name, std::ios::binary) << data;
+
+    Graph loaded;
+    create_chain(loaded);
+    bool is_thrown = false;
+    try {
+        loaded.load(file_name);
+    } catch (const std::exception &) {
+        is_thrown = true;
+    }
+
+    CHECK(is_thrown);
+    CHECK(loaded.nodes.size() == graph.nodes.size());
+    CHECK(loaded.links.size() == graph.links.size());
+    std::filesystem::remove(file_name);
+}